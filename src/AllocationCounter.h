@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// Number of operator new calls made by the calling thread, over-aligned ones included. Only debug builds install
+// the counting operator new (see main.cpp); in release builds this stays at zero.
+class AllocationCounter {
+public:
+    static size_t& ThreadCount() {
+        thread_local size_t count = 0;
+        return count;
+    }
+};
@@ -4,20 +4,21 @@
 #include <map>
 #include <vector>
 #include "SDL_mixer.h"
+#include "ResourceCache.h"
 
 using string = std::string;
 
 class AudioHandler {
 public:
-    std::map<string, Mix_Chunk*> effectMap;
+    std::map<string, SoundHandle> effectMap;
     std::map<string, Mix_Music*> trackMap;
 
-    AudioHandler(const std::vector<string>& effectPaths, const std::vector<string>& trackPaths) {
-        for (const string& effectPath : effectPaths) {
-            std::string name = effectPath.substr(0, effectPath.size()-4);
+    // Effects are file names in the cache's asset folder and load the first time they're played
+    AudioHandler(ResourceCache& resources, const std::vector<string>& effectFiles, const std::vector<string>& trackPaths) {
+        for (const string& effectFile : effectFiles) {
+            std::string name = effectFile.substr(0, effectFile.size()-4);
             name = name.substr(name.find_last_of('/') + 1);
-            Mix_Chunk* effect = Mix_LoadWAV(effectPath.c_str());
-            effectMap[name] = effect;
+            effectMap[name] = resources.Sound(effectFile);
         }
 
         for (const string& trackPath : trackPaths) {
@@ -30,8 +31,8 @@ public:
 
     bool PlayEffect(const string& name, int loops=1) {
         if (effectMap.count(name) > 0) {
-            const int returnCode = Mix_PlayChannel(-1, effectMap[name], loops);
-            if (returnCode != -1) {
+            Mix_Chunk* effect = effectMap[name].Get();
+            if (effect != nullptr && Mix_PlayChannel(-1, effect, loops) != -1) {
                 return true;
             }
         }
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include "Game.h"
+
+// Headless Monte-Carlo balancing: plays many seeded games with scripted placement strategies as fast as the
+// CPU allows, spread across all cores, and reports aggregate outcomes per parameter combination.
+
+enum PlacementStrategy {
+    STRATEGY_NONE,
+    STRATEGY_GREEDY_TURRETS,
+    STRATEGY_OBSTACLE_WALLS,
+    STRATEGY_MIXED
+};
+
+inline const char* PlacementStrategyName(PlacementStrategy strategy) {
+    switch (strategy) {
+        case STRATEGY_NONE:
+            return "none";
+        case STRATEGY_GREEDY_TURRETS:
+            return "turrets";
+        case STRATEGY_OBSTACLE_WALLS:
+            return "walls";
+        case STRATEGY_MIXED:
+            return "mixed";
+    }
+
+    return "";
+}
+
+struct BalanceScenario {
+    GameConfig config;
+    PlacementStrategy strategy = STRATEGY_GREEDY_TURRETS;
+    double waveTimeScale = 1.0;
+};
+
+struct BalanceSettings {
+    int runs = 1000;
+    unsigned int seed = 1;
+    int threads = 0; // 0 = one per hardware thread
+    double stepMs = 1000.0 / 60.0;
+    double decisionIntervalMs = 250.0;
+    double spawnJitter = 50.0; // Max random vertical offset applied to each spawn, in pixels
+    double maxGameMs = 60.0 * 60.0 * 1000.0;
+    bool endless = false; // Procedural waves instead of the wave file, runs end on defeat or maxGameMs
+};
+
+struct BalanceRunResult {
+    bool victorious = false;
+    int finalBalance = 0;
+    int safeZoneCellsLost = 0;
+    double survivedMs = 0.0;
+};
+
+struct BalanceSummary {
+    int runs = 0;
+    int wins = 0;
+    double meanBalance = 0.0;
+    int minBalance = 0;
+    int maxBalance = 0;
+    double meanCellsLost = 0.0;
+    double meanSurvivedMs = 0.0;
+};
+
+class StrategyPlayer {
+private:
+    PlacementStrategy strategy;
+    std::mt19937& rng;
+    int rowOrder[GRID_HEIGHT];
+
+public:
+    StrategyPlayer(PlacementStrategy strategy, std::mt19937& rng) : strategy(strategy), rng(rng) {
+        for (int i = 0; i < GRID_HEIGHT; i++) {
+            rowOrder[i] = i;
+        }
+        std::shuffle(rowOrder, rowOrder + GRID_HEIGHT, rng);
+    }
+
+    void Act(Game& game) {
+        switch (strategy) {
+            case STRATEGY_NONE:
+                break;
+            case STRATEGY_GREEDY_TURRETS:
+                while (PlaceInColumns(game, TURRET, GRID_WIDTH-4, 4)) {}
+                break;
+            case STRATEGY_OBSTACLE_WALLS:
+                while (PlaceInColumns(game, OBSTACLE, GRID_WIDTH-4, 4)) {}
+                break;
+            case STRATEGY_MIXED:
+                // A single obstacle wall in front of the barrier, turrets behind it with whatever is left
+                while (PlaceInColumns(game, OBSTACLE, GRID_WIDTH-4, GRID_WIDTH-4)) {}
+                while (PlaceInColumns(game, TURRET, GRID_WIDTH-5, 4)) {}
+                break;
+        }
+    }
+
+private:
+    // Fills columns right to left, rows in this player's shuffled order
+    bool PlaceInColumns(Game& game, EntityType type, int fromColumn, int toColumn) {
+        for (int i = fromColumn; i >= toColumn; i--) {
+            for (int row : rowOrder) {
+                if (game.CanPlaceEntity(i, row, type)) {
+                    return game.PlaceEntity(i, row, type);
+                }
+            }
+        }
+
+        return false;
+    }
+};
+
+inline BalanceRunResult RunBalanceGame(const BalanceScenario& scenario, const BalanceSettings& settings, const std::vector<EnemySpawn>& spawns, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::unique_ptr<EnemySpawner> spawner;
+
+    if (settings.endless) {
+        spawner = std::make_unique<EndlessSpawner>(seed, scenario.waveTimeScale);
+    } else {
+        const double maxStartY = static_cast<double>(BOX_SIZE.y * GRID_HEIGHT) - static_cast<double>(BOX_SIZE.y) * 0.75;
+        std::uniform_real_distribution<double> jitter(-settings.spawnJitter, settings.spawnJitter);
+        std::vector<EnemySpawn> runSpawns = spawns;
+        for (EnemySpawn& enemySpawn : runSpawns) {
+            enemySpawn.startY = std::clamp(enemySpawn.startY + jitter(rng), 0.0, maxStartY);
+        }
+        spawner = std::make_unique<ScriptedSpawner>(std::move(runSpawns), scenario.waveTimeScale);
+    }
+
+    Game game(scenario.config, GameTextures(), std::move(spawner));
+    StrategyPlayer player(scenario.strategy, rng);
+
+    double nextDecisionMs = 0.0;
+    while (!game.gameOver && game.gameClock < settings.maxGameMs) {
+        if (game.gameClock >= nextDecisionMs) {
+            player.Act(game);
+            nextDecisionMs += settings.decisionIntervalMs;
+        }
+
+        game.Update(settings.stepMs);
+        game.events.Clear();
+    }
+
+    BalanceRunResult result;
+    result.victorious = game.victorious;
+    result.finalBalance = game.balance;
+    result.safeZoneCellsLost = game.safeZoneCellsLost;
+    result.survivedMs = game.gameClock;
+    return result;
+}
+
+inline BalanceSummary RunBalanceScenario(const BalanceScenario& scenario, const BalanceSettings& settings, const std::vector<EnemySpawn>& spawns) {
+    std::vector<BalanceRunResult> results(settings.runs);
+    std::atomic<int> nextRun {0};
+
+    int threadCount = settings.threads > 0 ? settings.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, settings.runs));
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threadCount; i++) {
+        workers.emplace_back([&] {
+            for (int run = nextRun++; run < settings.runs; run = nextRun++) {
+                results[run] = RunBalanceGame(scenario, settings, spawns, settings.seed + static_cast<unsigned int>(run));
+            }
+        });
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    BalanceSummary summary;
+    summary.runs = settings.runs;
+    if (results.empty()) {
+        return summary;
+    }
+
+    summary.minBalance = results.front().finalBalance;
+    summary.maxBalance = results.front().finalBalance;
+    for (const BalanceRunResult& result : results) {
+        summary.wins += result.victorious ? 1 : 0;
+        summary.meanBalance += result.finalBalance;
+        summary.minBalance = std::min(summary.minBalance, result.finalBalance);
+        summary.maxBalance = std::max(summary.maxBalance, result.finalBalance);
+        summary.meanCellsLost += result.safeZoneCellsLost;
+        summary.meanSurvivedMs += result.survivedMs;
+    }
+    summary.meanBalance /= static_cast<double>(results.size());
+    summary.meanCellsLost /= static_cast<double>(results.size());
+    summary.meanSurvivedMs /= static_cast<double>(results.size());
+
+    return summary;
+}
+
+template<typename T>
+inline std::vector<T> ParseBalanceList(const string& text, T (*parse)(const string&)) {
+    std::vector<T> values;
+    std::stringstream stream(text);
+    string item;
+    while (std::getline(stream, item, ',')) {
+        values.push_back(parse(item));
+    }
+    return values;
+}
+
+inline void PrintBalanceUsage() {
+    std::cout << "Usage: LD54 --balance [options]\n"
+                 "  --runs N             games per parameter combination (default 1000)\n"
+                 "  --seed N             base seed, run i uses seed + i (default 1)\n"
+                 "  --threads N          worker threads (default: all cores)\n"
+                 "  --step-ms X          simulation step in ms (default 16.67)\n"
+                 "  --jitter PX          random spawn height offset (default 50)\n"
+                 "  --waves PATH         wave file (default game.json)\n"
+                 "  --endless            procedural endless waves, seeded per run\n"
+                 "  --max-seconds X      stop a run after this much game time (default 3600)\n"
+                 "  --strategy LIST      none,turrets,walls,mixed (default turrets)\n"
+                 "  --turret-cost LIST   e.g. 4,5,6\n"
+                 "  --obstacle-cost LIST\n"
+                 "  --enemy-speed LIST   pixels per ms\n"
+                 "  --wave-scale LIST    multiplier on spawn times\n"
+                 "  --start-balance LIST\n"
+                 "Every combination of the LIST options is run." << std::endl;
+}
+
+inline int RunBalanceCommand(int argc, char* argv[], const string& defaultWavesPath) {
+    BalanceSettings settings;
+    string wavesPath = defaultWavesPath;
+    std::vector<PlacementStrategy> strategies {STRATEGY_GREEDY_TURRETS};
+    std::vector<int> turretCosts {TURRET_VALUE};
+    std::vector<int> obstacleCosts {OBSTACLE_VALUE};
+    std::vector<int> startBalances {GameConfig().startingBalance};
+    std::vector<double> enemySpeeds {GameConfig().enemySpeed};
+    std::vector<double> waveScales {1.0};
+
+    auto parseInt = [](const string& text) { return std::stoi(text); };
+    auto parseDouble = [](const string& text) { return std::stod(text); };
+    auto parseStrategy = [](const string& text) {
+        for (PlacementStrategy strategy : {STRATEGY_NONE, STRATEGY_GREEDY_TURRETS, STRATEGY_OBSTACLE_WALLS, STRATEGY_MIXED}) {
+            if (text == PlacementStrategyName(strategy)) {
+                return strategy;
+            }
+        }
+        throw std::invalid_argument(text);
+    };
+
+    try {
+        for (int i = 2; i < argc; i++) {
+            const string option = argv[i];
+            if (option == "--endless") {
+                settings.endless = true;
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(option);
+            }
+            const string value = argv[++i];
+
+            if (option == "--runs") {
+                settings.runs = std::stoi(value);
+            } else if (option == "--seed") {
+                settings.seed = static_cast<unsigned int>(std::stoul(value));
+            } else if (option == "--threads") {
+                settings.threads = std::stoi(value);
+            } else if (option == "--step-ms") {
+                settings.stepMs = std::stod(value);
+            } else if (option == "--jitter") {
+                settings.spawnJitter = std::stod(value);
+            } else if (option == "--max-seconds") {
+                settings.maxGameMs = std::stod(value) * 1000.0;
+            } else if (option == "--waves") {
+                wavesPath = value;
+            } else if (option == "--strategy") {
+                strategies = ParseBalanceList<PlacementStrategy>(value, parseStrategy);
+            } else if (option == "--turret-cost") {
+                turretCosts = ParseBalanceList<int>(value, parseInt);
+            } else if (option == "--obstacle-cost") {
+                obstacleCosts = ParseBalanceList<int>(value, parseInt);
+            } else if (option == "--start-balance") {
+                startBalances = ParseBalanceList<int>(value, parseInt);
+            } else if (option == "--enemy-speed") {
+                enemySpeeds = ParseBalanceList<double>(value, parseDouble);
+            } else if (option == "--wave-scale") {
+                waveScales = ParseBalanceList<double>(value, parseDouble);
+            } else {
+                throw std::invalid_argument(option);
+            }
+        }
+    } catch (const std::exception&) {
+        PrintBalanceUsage();
+        return 1;
+    }
+
+    if (settings.runs <= 0 || settings.stepMs <= 0.0) {
+        PrintBalanceUsage();
+        return 1;
+    }
+
+    std::vector<EnemySpawn> spawns;
+    string error;
+    if (!settings.endless && !LoadEnemySpawns(wavesPath, spawns, error)) {
+        std::cout << "Could not load waves from " << error << std::endl;
+        return 1;
+    }
+
+    std::cout << std::left
+              << std::setw(10) << "strategy" << std::setw(8) << "turret" << std::setw(10) << "obstacle"
+              << std::setw(8) << "start" << std::setw(8) << "speed" << std::setw(8) << "waves"
+              << std::setw(8) << "win%" << std::setw(22) << "balance mean/min/max" << std::setw(12) << "cells lost"
+              << std::setw(12) << "survived s" << "ms" << std::endl;
+
+    const auto sweepStart = std::chrono::steady_clock::now();
+
+    for (PlacementStrategy strategy : strategies) {
+        for (int turretCost : turretCosts) {
+            for (int obstacleCost : obstacleCosts) {
+                for (int startBalance : startBalances) {
+                    for (double enemySpeed : enemySpeeds) {
+                        for (double waveScale : waveScales) {
+                            BalanceScenario scenario;
+                            scenario.strategy = strategy;
+                            scenario.config.turretValue = turretCost;
+                            scenario.config.obstacleValue = obstacleCost;
+                            scenario.config.startingBalance = startBalance;
+                            scenario.config.enemySpeed = enemySpeed;
+                            scenario.waveTimeScale = waveScale;
+
+                            const auto start = std::chrono::steady_clock::now();
+                            const BalanceSummary summary = RunBalanceScenario(scenario, settings, spawns);
+                            const auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+                            std::ostringstream balanceColumn;
+                            balanceColumn << std::fixed << std::setprecision(1) << summary.meanBalance << "/" << summary.minBalance << "/" << summary.maxBalance;
+
+                            std::cout << std::left << std::fixed << std::setprecision(2)
+                                      << std::setw(10) << PlacementStrategyName(strategy) << std::setw(8) << turretCost << std::setw(10) << obstacleCost
+                                      << std::setw(8) << startBalance << std::setw(8) << enemySpeed << std::setw(8) << waveScale
+                                      << std::setprecision(1) << std::setw(8) << (100.0 * summary.wins / summary.runs)
+                                      << std::setw(22) << balanceColumn.str() << std::setw(12) << summary.meanCellsLost
+                                      << std::setw(12) << summary.meanSurvivedMs / 1000.0 << elapsedMs << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    const auto totalMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sweepStart).count();
+    std::cout << "Sweep finished in " << totalMs << " ms" << std::endl;
+
+    return 0;
+}
@@ -3,34 +3,26 @@
 #include "SDL.h"
 #include "Vec2.h"
 
-class BoxCollider {
+template<typename T>
+class BasicBoxCollider {
 public:
-    Vec2 pos {0.0, 0.0};
-    Vec2 bounds {0.0, 0.0};
+    BasicVec2<T> pos {0, 0};
+    BasicVec2<T> bounds {0, 0};
 
 public:
-    BoxCollider() {
-        pos = {0.0, 0.0};
-        bounds = {0.0, 0.0};
-    }
+    constexpr BasicBoxCollider() = default;
 
-    BoxCollider(double x, double y, double w, double h) {
-        pos = {x, y};
-        bounds = {w, h};
-    }
+    constexpr BasicBoxCollider(T x, T y, T w, T h) : pos(x, y), bounds(w, h) {}
 
-    BoxCollider(Vec2 pos, Vec2 bounds) : pos(pos), bounds(bounds) {}
+    constexpr BasicBoxCollider(BasicVec2<T> pos, BasicVec2<T> bounds) : pos(pos), bounds(bounds) {}
 
-    BoxCollider(SDL_Rect rect) {
-        pos = {static_cast<double>(rect.x), static_cast<double>(rect.y)};
-        bounds = {static_cast<double>(rect.w), static_cast<double>(rect.h)};
-    }
+    constexpr BasicBoxCollider(SDL_Rect rect) : pos(static_cast<T>(rect.x), static_cast<T>(rect.y)), bounds(static_cast<T>(rect.w), static_cast<T>(rect.h)) {}
 
-    bool Contains(Vec2 point) const {
+    constexpr bool Contains(BasicVec2<T> point) const {
         return (point.x > pos.x && point.x < pos.x + bounds.x && point.y > pos.y && point.y < pos.y + bounds.y);
     }
 
-    bool Intersects(const BoxCollider& other) {
+    constexpr bool Intersects(const BasicBoxCollider& other) const {
         if (pos.x + bounds.x < other.pos.x || pos.x > other.pos.x + other.bounds.x) {
             return false;
         }
@@ -41,4 +33,55 @@ public:
 
         return true;
     }
-};
\ No newline at end of file
+
+    // Moves this box by motion and other by otherMotion over one step. If they touch at any point of it, returns true
+    // with timeOfImpact set to the earliest fraction of the step they do, 0 if they already touch. Touching edges
+    // count, like in Intersects, so a pair that intersects at the end of the step is always caught here too.
+    constexpr bool Sweep(BasicVec2<T> motion, const BasicBoxCollider& other, BasicVec2<T> otherMotion, T& timeOfImpact) const {
+        T enter = 0;
+        T exit = 1;
+
+        if (!SweepAxis(pos.x, bounds.x, other.pos.x, other.bounds.x, motion.x - otherMotion.x, enter, exit) ||
+            !SweepAxis(pos.y, bounds.y, other.pos.y, other.bounds.y, motion.y - otherMotion.y, enter, exit)) {
+            return false;
+        }
+
+        timeOfImpact = enter;
+        return true;
+    }
+
+    constexpr bool Sweep(BasicVec2<T> motion, const BasicBoxCollider& other, T& timeOfImpact) const {
+        return Sweep(motion, other, {0, 0}, timeOfImpact);
+    }
+
+private:
+    // Narrows [enter, exit] to the part of the step in which the boxes overlap along one axis. Quotients are only
+    // taken when they land in [0, 1], so this can't overflow in fixed point however slow the relative motion is.
+    static constexpr bool SweepAxis(T start, T size, T otherStart, T otherSize, T velocity, T& enter, T& exit) {
+        if (velocity == T(0)) {
+            return !(start + size < otherStart || start > otherStart + otherSize);
+        }
+
+        const T speed = velocity > T(0) ? velocity : -velocity;
+        const T enterDistance = velocity > T(0) ? otherStart - (start + size) : start - (otherStart + otherSize);
+        const T exitDistance = velocity > T(0) ? otherStart + otherSize - start : start + size - otherStart;
+
+        if (exitDistance < T(0) || enterDistance > speed) {
+            return false;
+        }
+
+        if (enterDistance > T(0)) {
+            const T axisEnter = enterDistance / speed;
+            enter = axisEnter > enter ? axisEnter : enter;
+        }
+
+        if (exitDistance < speed) {
+            const T axisExit = exitDistance / speed;
+            exit = axisExit < exit ? axisExit : exit;
+        }
+
+        return enter <= exit;
+    }
+};
+
+using BoxCollider = BasicBoxCollider<Scalar>;
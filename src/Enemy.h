@@ -2,24 +2,51 @@
 
 #include "SDL.h"
 #include "BoxCollider.h"
+#include "RenderQueue.h"
 
 class Enemy {
 public:
     int id;
     BoxCollider collider;
     SDL_Texture* texture;
-    double speed;
+    Scalar speed;
     bool removed = false;
 
-    Enemy(int id, SDL_Texture* texture, BoxCollider collider, double speed) : id(id), collider(collider), texture(texture), speed(speed) {}
+    // Where the current step started and how far it moved, so collisions can be swept along the whole path
+    BoxCollider stepStart;
+    Vec2 stepMotion {0, 0};
+
+    // Earliest contact this step with a placed entity (cellX/cellY >= 0) or the wall (-1)
+    bool contactPending = false;
+    Scalar contactTime = 0;
+    int contactCellX = -1;
+    int contactCellY = -1;
+
+    Enemy(int id, SDL_Texture* texture, BoxCollider collider, Scalar speed) : id(id), collider(collider), texture(texture), speed(speed), stepStart(collider) {}
 
     void Update(double frameDelta) {
-        collider.pos.x += (frameDelta * speed);
+        stepStart = collider;
+        stepMotion = {Scalar(frameDelta) * speed, 0};
+        contactPending = false;
+        collider.pos.x += stepMotion.x;
+    }
+
+    // Position at a fraction of the current step
+    Vec2 PositionAt(Scalar time) const {
+        return {stepStart.pos.x + stepMotion.x * time, stepStart.pos.y + stepMotion.y * time};
+    }
+
+    void SetContact(Scalar time, int cellX, int cellY) {
+        if (!contactPending || time < contactTime) {
+            contactPending = true;
+            contactTime = time;
+            contactCellX = cellX;
+            contactCellY = cellY;
+        }
     }
 
-    void Draw(SDL_Renderer* renderer) {
-        SDL_Rect rect {static_cast<int>(collider.pos.x), static_cast<int>(collider.pos.y), static_cast<int>(collider.bounds.x), static_cast<int>(collider.bounds.y)};
-        SDL_RenderCopy(renderer, texture, nullptr, &rect);
+    void Draw(RenderQueue& queue, RenderLayer layer) const {
+        queue.Sprite(layer, texture, {static_cast<int>(collider.pos.x), static_cast<int>(collider.pos.y), static_cast<int>(collider.bounds.x), static_cast<int>(collider.bounds.y)});
     }
 
     bool operator== (const Enemy& other) const {
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Snapshot.h"
+
+enum EnemyType {
+    VAN,
+    PICKUP
+};
+
+struct EnemySpawn {
+    double spawnTime;
+    EnemyType type;
+    double startY;
+    double speedScale = 1.0;
+};
+
+// Source of enemy spawns in ascending spawnTime order
+class EnemySpawner {
+public:
+    virtual ~EnemySpawner() = default;
+
+    // nullptr once no spawns remain
+    virtual const EnemySpawn* Peek() = 0;
+    virtual void Pop() = 0;
+
+    // Position in the spawn sequence, for Game snapshots. The spawn list itself is not included.
+    virtual void SaveState(SnapshotWriter& writer) const = 0;
+    virtual bool LoadState(SnapshotReader& reader) = 0;
+
+    // Same spawn list, same position, for a second Game that loads this one's snapshots
+    virtual std::unique_ptr<EnemySpawner> Clone() const = 0;
+};
+
+// SplitMix64. Eight bytes of state keeps spawner snapshots small, and unlike the std distributions the
+// sequence is the same on every standard library.
+class SpawnRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit SpawnRandom(uint64_t seed) : state(seed) {}
+
+    uint64_t Next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Uniform in [min, max)
+    double Uniform(double min, double max) {
+        return min + (max - min) * static_cast<double>(Next() >> 11) * 0x1.0p-53;
+    }
+};
+
+// e^x from IEEE-754 + - * / only. Those round the same on every platform we build for, with contraction into FMAs
+// turned off (see CMakeLists.txt), whereas std::exp comes from the platform's libm and can differ in the last bit.
+// Accurate to a few ulp; underflows to 0 a little early, below -708.
+inline double PortableExp(double x) {
+    if (x < -708.0) {
+        return 0.0;
+    }
+
+    // x = k ln2 + r with |r| <= ln2 / 2. ln2 is split in two so k * LN2_HI is exact.
+    constexpr double LN2_HI = 6.93147180369123816490e-01;
+    constexpr double LN2_LO = 1.90821492927058770002e-10;
+    constexpr double INV_LN2 = 1.44269504088896338700e+00;
+    const double k = std::floor(x * INV_LN2 + 0.5);
+    const double r = (x - k * LN2_HI) - k * LN2_LO;
+
+    // Taylor series to r^13 / 13!, below 1e-17 for |r| <= 0.35
+    double term = 1.0;
+    double sum = 1.0;
+    for (int i = 1; i <= 13; i++) {
+        term = term * r / i;
+        sum += term;
+    }
+
+    // Scaling by a power of two is exact
+    return std::ldexp(sum, static_cast<int>(k));
+}
+
+struct DifficultyCurve {
+    double startIntervalMs = 2500.0;
+    double minIntervalMs = 400.0;
+    double rampMs = 180000.0;          // Time for the interval to close ~63% of the gap to the minimum
+    double groupEveryMs = 90000.0;     // One more simultaneous enemy per group this often
+    int maxGroupSize = 4;
+    double speedRampPerMinute = 0.05;  // Added to the speed scale each minute
+    double maxSpeedScale = 2.0;
+    double pickupChance = 0.5;
+    double minY = 0.0;
+    double maxY = 862.0;
+};
+
+// Never runs out. Spawns are generated from a seeded difficulty curve one window at a time into fixed storage,
+// so memory stays constant however long the session runs.
+class EndlessSpawner : public EnemySpawner {
+private:
+    static constexpr size_t WINDOW_SIZE = 64;
+
+    DifficultyCurve curve;
+    double timeScale;
+    SpawnRandom rng;
+    std::array<EnemySpawn, WINDOW_SIZE> window {};
+    size_t length = 0;  // Spawns in the window, whole groups only
+    size_t cursor = 0;
+    double nextGroupTime = 0.0;
+
+public:
+    explicit EndlessSpawner(unsigned int seed, double timeScale = 1.0, const DifficultyCurve& curve = DifficultyCurve())
+            : curve(curve), timeScale(timeScale), rng(seed) {}
+
+    const EnemySpawn* Peek() override {
+        if (cursor >= length) {
+            GenerateWindow();
+        }
+
+        return &window[cursor];
+    }
+
+    void Pop() override {
+        if (cursor >= length) {
+            GenerateWindow();
+        }
+
+        cursor++;
+    }
+
+    std::unique_ptr<EnemySpawner> Clone() const override {
+        return std::make_unique<EndlessSpawner>(*this);
+    }
+
+    void SaveState(SnapshotWriter& writer) const override {
+        writer.Write(rng);
+        writer.Write(static_cast<uint64_t>(length));
+        writer.Write(static_cast<uint64_t>(cursor));
+        writer.Write(nextGroupTime);
+        writer.Write(window);
+    }
+
+    bool LoadState(SnapshotReader& reader) override {
+        SpawnRandom savedRng(0);
+        uint64_t savedLength = 0;
+        uint64_t savedCursor = 0;
+        double savedNextGroupTime = 0.0;
+        if (!reader.Read(savedRng) || !reader.Read(savedLength) || !reader.Read(savedCursor) || !reader.Read(savedNextGroupTime)
+                || savedLength > WINDOW_SIZE || savedCursor > savedLength) {
+            return false;
+        }
+
+        if (!reader.Read(window)) {
+            return false;
+        }
+
+        rng = savedRng;
+        length = static_cast<size_t>(savedLength);
+        cursor = static_cast<size_t>(savedCursor);
+        nextGroupTime = savedNextGroupTime;
+        return true;
+    }
+
+private:
+    void GenerateWindow() {
+        size_t count = 0;
+        while (true) {
+            const double t = nextGroupTime;
+            const int groupSize = std::min({curve.maxGroupSize, 1 + static_cast<int>(t / curve.groupEveryMs), static_cast<int>(WINDOW_SIZE)});
+            const double speedScale = std::min(curve.maxSpeedScale, 1.0 + curve.speedRampPerMinute * (t / 60000.0));
+
+            // A group that doesn't fit goes whole into the next window, so none of its spawns are lost and the
+            // spawns inside a window stay sorted
+            if (count + static_cast<size_t>(groupSize) > WINDOW_SIZE) {
+                break;
+            }
+
+            for (int i = 0; i < groupSize; i++) {
+                EnemySpawn& spawn = window[count++];
+                spawn.spawnTime = t * timeScale;
+                spawn.type = rng.Uniform(0.0, 1.0) < curve.pickupChance ? PICKUP : VAN;
+                spawn.startY = rng.Uniform(curve.minY, curve.maxY);
+                spawn.speedScale = speedScale;
+            }
+
+            const double interval = curve.minIntervalMs + (curve.startIntervalMs - curve.minIntervalMs) * PortableExp(-t / curve.rampMs);
+            nextGroupTime += interval;
+        }
+
+        length = count;
+        cursor = 0;
+    }
+};
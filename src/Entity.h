@@ -2,6 +2,7 @@
 
 #include "SDL.h"
 #include "BoxCollider.h"
+#include "RenderQueue.h"
 #include "Vec2Int.h"
 
 class Entity {
@@ -10,17 +11,18 @@ public:
     SDL_Texture* texture;
     double timeSinceCreationMs = 0.0;
 
+    virtual ~Entity() = default;
+
     virtual void Update(double frameDelta) {
         timeSinceCreationMs += frameDelta;
     }
 
-    void Draw(SDL_Renderer* renderer) {
-        SDL_Rect rect {static_cast<int>(collider.pos.x), static_cast<int>(collider.pos.y), static_cast<int>(collider.bounds.x), static_cast<int>(collider.bounds.y)};
-        SDL_RenderCopy(renderer, texture, nullptr, &rect);
+    void Draw(RenderQueue& queue, RenderLayer layer) const {
+        queue.Sprite(layer, texture, {static_cast<int>(collider.pos.x), static_cast<int>(collider.pos.y), static_cast<int>(collider.bounds.x), static_cast<int>(collider.bounds.y)});
     }
 
     Entity(Vec2 pos, const Vec2& size, SDL_Texture* texture) : texture(texture) {
-        collider = BoxCollider(static_cast<double>(pos.x), static_cast<double>(pos.y), size.x, size.y);
+        collider = BoxCollider(pos, size);
     }
 };
 
@@ -29,29 +31,25 @@ public:
     const double FIRE_INTERVAL_MS = 2000.0;
     double fireTimerMs = 0.0;
 
-    std::vector<Entity>& projectiles;
-    Vec2 projectileSize;
-    SDL_Texture* projectileTexture;
-    AudioHandler& audioHandler;
-
-    TurretEntity(Vec2 pos, const Vec2& turretSize, SDL_Texture* turretTexture, const Vec2& projectileSize, SDL_Texture* projectileTexture, std::vector<Entity>& projectiles, AudioHandler& audioHandler) : Entity(pos, turretSize, turretTexture),
-                                                                                                                                                                                  projectileSize(projectileSize), projectileTexture(projectileTexture), projectiles(projectiles), audioHandler(audioHandler) {
-    }
+    TurretEntity(Vec2 pos, const Vec2& turretSize, SDL_Texture* turretTexture) : Entity(pos, turretSize, turretTexture) {}
 
     void Update(double frameDelta) override {
         timeSinceCreationMs += frameDelta;
         fireTimerMs += frameDelta;
+    }
 
+    // True once per fire interval, the caller is responsible for spawning the projectile. Carries the overshoot
+    // into the next interval so the rate of fire doesn't depend on the step size.
+    bool ConsumeShot() {
         if (fireTimerMs >= FIRE_INTERVAL_MS) {
-            Fire();
-            fireTimerMs = 0.0;
+            fireTimerMs -= FIRE_INTERVAL_MS;
+            return true;
         }
+
+        return false;
     }
 
-    void Fire() {
-        Vec2 projectilePos {collider.pos.x + (collider.bounds.x/2) - (projectileSize.x/2), collider.pos.y + (collider.bounds.y/2) - (projectileSize.y/2)};
-        Entity projectile(projectilePos, projectileSize, projectileTexture);
-        projectiles.push_back(projectile);
-        audioHandler.PlayEffect("TurretFire");
+    Vec2 ProjectilePos(const Vec2& projectileSize) const {
+        return {collider.pos.x + (collider.bounds.x/2) - (projectileSize.x/2), collider.pos.y + (collider.bounds.y/2) - (projectileSize.y/2)};
     }
 };
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <vector>
+
+// Typed event queues, one contiguous buffer per event type. Systems append during a tick and consumers walk
+// each buffer in one batch afterwards. Buffers keep their capacity across Clear(), so steady-state ticks don't
+// allocate.
+template<typename... Events>
+class EventBus {
+private:
+    std::tuple<std::vector<Events>...> buffers;
+
+public:
+    explicit EventBus(size_t reservePerType = 64) {
+        (std::get<std::vector<Events>>(buffers).reserve(reservePerType), ...);
+    }
+
+    template<typename T>
+    void Emit(const T& event) {
+        std::get<std::vector<T>>(buffers).push_back(event);
+    }
+
+    template<typename T>
+    const std::vector<T>& Get() const {
+        return std::get<std::vector<T>>(buffers);
+    }
+
+    void Clear() {
+        (std::get<std::vector<Events>>(buffers).clear(), ...);
+    }
+};
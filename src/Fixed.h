@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+
+// Signed binary fixed-point number with FractionBits fractional bits stored in Rep. All arithmetic is integer,
+// so results are bit-identical across compilers, optimization flags and CPUs. Products and quotients are
+// computed in Wide and truncated; debug builds assert when a result doesn't fit back into Rep.
+template<int FractionBits, typename Rep = int32_t, typename Wide = int64_t>
+class Fixed {
+    static_assert(std::numeric_limits<Rep>::is_signed && std::numeric_limits<Wide>::is_signed, "Fixed needs signed storage");
+    static_assert(sizeof(Wide) >= 2 * sizeof(Rep), "Wide must hold the product of two Reps");
+    static_assert(FractionBits > 0 && FractionBits < static_cast<int>(sizeof(Rep) * 8) - 1, "Bad fraction size");
+
+public:
+    static constexpr Wide ONE = static_cast<Wide>(1) << FractionBits;
+
+    Rep raw = 0;
+
+    constexpr Fixed() = default;
+
+    constexpr Fixed(int value) : raw(Narrow(static_cast<Wide>(value) * ONE)) {}
+
+    // Rounds to nearest, half away from zero
+    constexpr Fixed(double value) : raw(RoundFromDouble(value)) {}
+
+    static constexpr Fixed FromRaw(Rep value) {
+        Fixed result;
+        result.raw = value;
+        return result;
+    }
+
+    constexpr explicit operator double() const {
+        return static_cast<double>(raw) / static_cast<double>(ONE);
+    }
+
+    constexpr explicit operator float() const {
+        return static_cast<float>(raw) / static_cast<float>(ONE);
+    }
+
+    // Truncates toward zero, like a cast from double
+    constexpr explicit operator int() const {
+        return static_cast<int>(raw / static_cast<Rep>(ONE));
+    }
+
+    constexpr Fixed operator-() const {
+        return FromRaw(Narrow(-static_cast<Wide>(raw)));
+    }
+
+    constexpr Fixed& operator+=(Fixed other) {
+        raw = Narrow(static_cast<Wide>(raw) + other.raw);
+        return *this;
+    }
+
+    constexpr Fixed& operator-=(Fixed other) {
+        raw = Narrow(static_cast<Wide>(raw) - other.raw);
+        return *this;
+    }
+
+    constexpr Fixed& operator*=(Fixed other) {
+        raw = Narrow(FloorShift(static_cast<Wide>(raw) * other.raw));
+        return *this;
+    }
+
+    constexpr Fixed& operator/=(Fixed other) {
+        assert(other.raw != 0 && "Fixed division by zero");
+        raw = Narrow((static_cast<Wide>(raw) * ONE) / other.raw);
+        return *this;
+    }
+
+    // Hidden friends, so an int or double on either side converts implicitly
+    friend constexpr Fixed operator+(Fixed a, Fixed b) {
+        return a += b;
+    }
+
+    friend constexpr Fixed operator-(Fixed a, Fixed b) {
+        return a -= b;
+    }
+
+    friend constexpr Fixed operator*(Fixed a, Fixed b) {
+        return a *= b;
+    }
+
+    friend constexpr Fixed operator/(Fixed a, Fixed b) {
+        return a /= b;
+    }
+
+    friend constexpr bool operator==(Fixed a, Fixed b) {
+        return a.raw == b.raw;
+    }
+
+    friend constexpr bool operator!=(Fixed a, Fixed b) {
+        return a.raw != b.raw;
+    }
+
+    friend constexpr bool operator<(Fixed a, Fixed b) {
+        return a.raw < b.raw;
+    }
+
+    friend constexpr bool operator>(Fixed a, Fixed b) {
+        return a.raw > b.raw;
+    }
+
+    friend constexpr bool operator<=(Fixed a, Fixed b) {
+        return a.raw <= b.raw;
+    }
+
+    friend constexpr bool operator>=(Fixed a, Fixed b) {
+        return a.raw >= b.raw;
+    }
+
+private:
+    static constexpr Rep RoundFromDouble(double value) {
+        const double scaled = value * static_cast<double>(ONE) + (value >= 0.0 ? 0.5 : -0.5);
+        assert(scaled < static_cast<double>(std::numeric_limits<Rep>::max()) + 1.0 && "Fixed overflow");
+        assert(scaled > static_cast<double>(std::numeric_limits<Rep>::min()) - 1.0 && "Fixed overflow");
+        return static_cast<Rep>(scaled);
+    }
+
+    // value / ONE rounded down, what an arithmetic right shift gives. Shifting a negative value right is
+    // implementation-defined before C++20, so negatives are shifted as their complement.
+    static constexpr Wide FloorShift(Wide value) {
+        return value >= 0 ? value >> FractionBits : -((-(value + 1)) >> FractionBits) - 1;
+    }
+
+    static constexpr Rep Narrow(Wide value) {
+        assert(value >= std::numeric_limits<Rep>::min() && value <= std::numeric_limits<Rep>::max() && "Fixed overflow");
+        return static_cast<Rep>(value);
+    }
+};
+
+// 32-bit lanes with a range of +-32768 and a resolution of ~0.000015, plenty for a 1600x900 playfield
+using Fixed16_16 = Fixed<16>;
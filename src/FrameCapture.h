@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SDL.h"
+#include "RingQueue.h"
+
+using string = std::string;
+
+struct CaptureSettings {
+    int fps = 30;           // Capture rate while the encoder keeps up, and the rate written into the file
+    int minFps = 5;         // Lowest rate backing off goes to
+    int buffers = 6;        // Frames that can wait for the encoder before captures are skipped
+};
+
+struct CaptureStats {
+    unsigned long long frames = 0;          // Frames drawn while capturing
+    unsigned long long captured = 0;
+    unsigned long long skipped = 0;         // Due, but every buffer was still waiting for the encoder
+    unsigned long long written = 0;
+    double readbackMs = 0.0;                // Main thread time spent reading frames back
+    double maxReadbackMs = 0.0;
+    double encodeMs = 0.0;                  // Encoder thread time spent converting and writing
+    bool writeFailed = false;
+};
+
+// Records the game's render target to a Y4M video (raw 4:2:0, playable by ffplay/mpv/VLC, or ffmpeg -i to compress).
+// The main thread only copies a due frame into a free buffer out of a fixed ring; converting and writing happen on
+// a background thread. When no buffer is free the frame is skipped rather than waited for, and the capture rate
+// halves until the encoder catches up again, so a slow disk costs frames, never frame time. Skipped frames are
+// not written at all, so playback runs that much shorter than the session.
+class FrameCapture {
+private:
+    static constexpr size_t MAX_BUFFERS = 16;
+
+    int width;
+    int height;
+    CaptureSettings settings;
+
+    std::vector<std::vector<uint8_t>> buffers;
+    std::vector<uint8_t> yuv;
+    RingQueue<int, MAX_BUFFERS> freeBuffers;
+    RingQueue<int, MAX_BUFFERS> pendingBuffers;
+    std::atomic<int> pendingCount {0};
+
+    std::ofstream file;
+    std::thread encodeThread;
+    std::atomic<bool> running {false};
+    std::atomic<unsigned long long> writtenCount {0};
+    std::atomic<unsigned long long> encodeNs {0};
+    std::atomic<bool> writeFailed {false};
+
+    CaptureStats stats;
+    Uint64 nextCaptureMs = 0;
+    Uint64 intervalMs = 0;
+
+public:
+    FrameCapture(int width, int height, const CaptureSettings& settings = CaptureSettings())
+            : width(width), height(height), settings(settings) {
+        this->settings.fps = std::max(1, this->settings.fps);
+        this->settings.minFps = std::clamp(this->settings.minFps, 1, this->settings.fps);
+        this->settings.buffers = std::clamp(this->settings.buffers, 1, static_cast<int>(MAX_BUFFERS));
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    ~FrameCapture() {
+        Stop();
+    }
+
+    bool Active() const {
+        return running;
+    }
+
+    // Buffers are allocated on the first start and kept for the next one
+    bool Start(const string& path) {
+        if (running) {
+            return true;
+        }
+
+        file.open(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            SDL_Log("Failed to open %s for capture", path.c_str());
+            return false;
+        }
+
+        file << "YUV4MPEG2 W" << width << " H" << height << " F" << settings.fps << ":1 Ip A1:1 C420jpeg\n";
+
+        if (buffers.empty()) {
+            buffers.assign(settings.buffers, std::vector<uint8_t>(static_cast<size_t>(width) * height * 4));
+            yuv.resize(static_cast<size_t>(width) * height + 2 * ChromaSize());
+        }
+
+        int index = 0;
+        while (pendingBuffers.Pop(index)) {}
+        while (freeBuffers.Pop(index)) {}
+        for (int i = 0; i < settings.buffers; i++) {
+            freeBuffers.Push(i);
+        }
+
+        stats = CaptureStats();
+        pendingCount = 0;
+        writtenCount = 0;
+        encodeNs = 0;
+        writeFailed = false;
+        intervalMs = BaseIntervalMs();
+        nextCaptureMs = 0;
+
+        running = true;
+        encodeThread = std::thread([this] { Encode(); });
+        return true;
+    }
+
+    // Waits for frames already captured to be written
+    void Stop() {
+        if (!running) {
+            return;
+        }
+
+        running = false;
+        encodeThread.join();
+        file.close();
+
+        stats.written = writtenCount;
+        stats.encodeMs = static_cast<double>(encodeNs) / 1e6;
+        stats.writeFailed = writeFailed;
+    }
+
+    // Main thread, once a frame with the frame drawn into the current render target
+    void Capture(SDL_Renderer* renderer) {
+        if (!running) {
+            return;
+        }
+
+        stats.frames++;
+        const Uint64 now = SDL_GetTicks64();
+        if (now < nextCaptureMs) {
+            return;
+        }
+        nextCaptureMs = std::max(nextCaptureMs + intervalMs, now);
+
+        int index = 0;
+        if (!freeBuffers.Pop(index)) {
+            stats.skipped++;
+            intervalMs = std::min(intervalMs * 2, 1000 / static_cast<Uint64>(settings.minFps));
+            return;
+        }
+
+        const Uint64 start = SDL_GetPerformanceCounter();
+        if (SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA32, buffers[index].data(), width * 4) != 0) {
+            freeBuffers.Push(index);
+            return;
+        }
+        const double readbackMs = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+
+        stats.captured++;
+        stats.readbackMs += readbackMs;
+        stats.maxReadbackMs = std::max(stats.maxReadbackMs, readbackMs);
+
+        // Back up to full rate once the encoder has nothing left waiting
+        if (pendingCount.load(std::memory_order_relaxed) == 0) {
+            intervalMs = std::max(BaseIntervalMs(), intervalMs / 2);
+        }
+
+        pendingCount.fetch_add(1, std::memory_order_relaxed);
+        pendingBuffers.Push(index);
+    }
+
+    // Only complete after Stop
+    const CaptureStats& Stats() const {
+        return stats;
+    }
+
+    void PrintReport(std::ostream& out) const {
+        const double frames = static_cast<double>(std::max(1ull, stats.frames));
+        const double captured = static_cast<double>(std::max(1ull, stats.captured));
+        out << "Capture: " << stats.written << " frames written, " << stats.skipped << " skipped of " << stats.frames
+            << " drawn" << (stats.writeFailed ? ", WRITE FAILED" : "") << std::endl;
+        out << "  main thread " << std::fixed << std::setprecision(3) << stats.readbackMs / frames << " ms per frame drawn, "
+            << stats.readbackMs / captured << " ms per capture, " << stats.maxReadbackMs << " ms worst" << std::endl;
+        out << "  encoder     " << stats.encodeMs / static_cast<double>(std::max(1ull, stats.written)) << " ms per frame written" << std::endl;
+    }
+
+private:
+    Uint64 BaseIntervalMs() const {
+        return 1000 / static_cast<Uint64>(settings.fps);
+    }
+
+    size_t ChromaSize() const {
+        return static_cast<size_t>((width + 1) / 2) * static_cast<size_t>((height + 1) / 2);
+    }
+
+    void Encode() {
+        int index = 0;
+
+        while (true) {
+            if (pendingBuffers.Pop(index)) {
+                Write(index);
+                continue;
+            }
+
+            if (!running) {
+                // Pick up anything captured between the last pop and the stop request
+                while (pendingBuffers.Pop(index)) {
+                    Write(index);
+                }
+                file.flush();
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    void Write(int index) {
+        const auto start = std::chrono::steady_clock::now();
+
+        ConvertToYuv(buffers[index].data());
+        freeBuffers.Push(index);
+        pendingCount.fetch_sub(1, std::memory_order_relaxed);
+
+        file << "FRAME\n";
+        file.write(reinterpret_cast<const char*>(yuv.data()), static_cast<std::streamsize>(yuv.size()));
+        if (!file) {
+            writeFailed = true;
+        } else {
+            writtenCount++;
+        }
+
+        encodeNs += static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    // Full range BT.601, chroma averaged over each 2x2 block
+    void ConvertToYuv(const uint8_t* rgba) {
+        const int chromaWidth = (width + 1) / 2;
+        const int chromaHeight = (height + 1) / 2;
+        uint8_t* yPlane = yuv.data();
+        uint8_t* uPlane = yPlane + static_cast<size_t>(width) * height;
+        uint8_t* vPlane = uPlane + ChromaSize();
+
+        for (int y = 0; y < height; y++) {
+            const uint8_t* row = rgba + static_cast<size_t>(y) * width * 4;
+            uint8_t* out = yPlane + static_cast<size_t>(y) * width;
+            for (int x = 0; x < width; x++) {
+                const int r = row[x * 4];
+                const int g = row[x * 4 + 1];
+                const int b = row[x * 4 + 2];
+                out[x] = static_cast<uint8_t>((77 * r + 150 * g + 29 * b) >> 8);
+            }
+        }
+
+        for (int cy = 0; cy < chromaHeight; cy++) {
+            const uint8_t* row0 = rgba + static_cast<size_t>(cy * 2) * width * 4;
+            const uint8_t* row1 = rgba + static_cast<size_t>(std::min(cy * 2 + 1, height - 1)) * width * 4;
+            for (int cx = 0; cx < chromaWidth; cx++) {
+                const int x0 = cx * 2 * 4;
+                const int x1 = std::min(cx * 2 + 1, width - 1) * 4;
+                const int r = row0[x0] + row0[x1] + row1[x0] + row1[x1];
+                const int g = row0[x0 + 1] + row0[x1 + 1] + row1[x0 + 1] + row1[x1 + 1];
+                const int b = row0[x0 + 2] + row0[x1 + 2] + row1[x0 + 2] + row1[x1 + 2];
+                const size_t i = static_cast<size_t>(cy) * chromaWidth + cx;
+                uPlane[i] = static_cast<uint8_t>(((-43 * r - 85 * g + 128 * b) >> 10) + 128);
+                vPlane[i] = static_cast<uint8_t>(((128 * r - 107 * g - 21 * b) >> 10) + 128);
+            }
+        }
+    }
+};
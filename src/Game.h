@@ -0,0 +1,611 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "SDL.h"
+#include "BoxCollider.h"
+#include "Enemy.h"
+#include "EnemySpawner.h"
+#include "EventBus.h"
+#include "Entity.h"
+#include "Snapshot.h"
+#include "Vec2.h"
+#include "Vec2Int.h"
+#include "WaveSchedule.h"
+
+using string = std::string;
+
+const int GRID_WIDTH = 32;
+const int GRID_HEIGHT = 18;
+const Vec2Int BOX_SIZE {50, 50};
+const int TURRET_VALUE = 5;
+const int OBSTACLE_VALUE = 1;
+
+enum GroundType {
+    DEFAULT_GROUND,
+    SAFE_ZONE,
+    WALL,
+    PARKING_LOT
+};
+
+enum EntityType {
+    NO_ENTITY,
+    TURRET,
+    OBSTACLE
+};
+
+struct Cell {
+    GroundType ground;
+    EntityType entityType;
+    Entity* entity = nullptr;
+};
+
+struct EnemySpawnedEvent {
+    int enemyId;
+    EnemyType type;
+    Vec2 pos;
+};
+
+struct TurretFiredEvent {
+    int cellX;
+    int cellY;
+    Vec2 projectilePos;
+};
+
+// An enemy destroyed by a projectile, or by running into a placed entity (cellX/cellY >= 0)
+struct EnemyHitEvent {
+    int enemyId;
+    Vec2 pos;
+    int cellX;
+    int cellY;
+};
+
+struct WallBreachEvent {
+    int enemyId;
+    Vec2 pos;
+};
+
+struct EntityPlacedEvent {
+    EntityType type;
+    int cellX;
+    int cellY;
+    int cost;
+};
+
+struct EntitySoldEvent {
+    EntityType type;
+    int cellX;
+    int cellY;
+    int refund;
+};
+
+using GameEventBus = EventBus<EnemySpawnedEvent, TurretFiredEvent, EnemyHitEvent, WallBreachEvent, EntityPlacedEvent, EntitySoldEvent>;
+
+// Everything that can be tuned without touching code. Defaults match the shipped game.
+struct GameConfig {
+    int turretValue = TURRET_VALUE;
+    int obstacleValue = OBSTACLE_VALUE;
+    int startingBalance = 25;
+    double enemySpeed = 0.25;
+};
+
+// Left as nullptr when running headless
+struct GameTextures {
+    SDL_Texture* turret = nullptr;
+    SDL_Texture* obstacle = nullptr;
+    SDL_Texture* projectile = nullptr;
+    SDL_Texture* van = nullptr;
+    SDL_Texture* pickupTruck = nullptr;
+};
+
+// The simulated world: grid, enemies, projectiles, spawning and economy. Owns no window, renderer or audio,
+// so it runs the same with or without SDL. Everything it does that the outside world may care about is
+// published on `events`, which the owner clears once its consumers have run.
+class Game {
+public:
+    GameConfig config;
+    GameTextures textures;
+    Cell** map;
+    BoxCollider wallCollider;
+    std::vector<Enemy> enemies;
+    std::vector<Entity> projectiles;
+    std::unique_ptr<EnemySpawner> spawner;
+    GameEventBus events;
+    int balance;
+    double gameClock = 0.0;
+    long long tick = 0;
+    int currentHighestEnemyId = 0;
+    int safeZoneCellsLost = 0;
+    bool gameOver = false;
+    bool victorious = false;
+
+private:
+    static constexpr size_t ENEMY_RESERVE = 256;
+    static constexpr uint32_t SNAPSHOT_MAGIC = 0x3435444C; // "LD54"
+    static constexpr uint32_t SNAPSHOT_VERSION = 2;
+    static constexpr size_t SNAPSHOT_SIZE_OFFSET = 2 * sizeof(uint32_t);
+
+public:
+    Game(const GameConfig& config, const GameTextures& textures, std::unique_ptr<EnemySpawner> spawner)
+            : config(config), textures(textures), wallCollider(BOX_SIZE.x * (GRID_WIDTH-3), 0, BOX_SIZE.x, BOX_SIZE.y * GRID_HEIGHT),
+              spawner(std::move(spawner)), balance(config.startingBalance) {
+        map = static_cast<Cell**>(malloc(sizeof(Cell*) * GRID_WIDTH));
+        for (int i = 0; i < GRID_WIDTH; i++) {
+            map[i] = static_cast<Cell*>(malloc(sizeof(Cell) * GRID_HEIGHT));
+        }
+
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                map[i][j].ground = WALL;
+                map[i][j].entityType = NO_ENTITY;
+                map[i][j].entity = nullptr;
+            }
+        }
+
+        for (int i = 4; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                map[i][j].ground = DEFAULT_GROUND;
+                map[i][j].entityType = NO_ENTITY;
+                map[i][j].entity = nullptr;
+            }
+        }
+
+        for (int i = 0; i < GRID_HEIGHT; i++) {
+            map[GRID_WIDTH-3][i].ground = WALL;
+        }
+
+        for (int i = GRID_WIDTH-2; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                map[i][j].ground = SAFE_ZONE;
+            }
+        }
+
+        // At most one projectile per turret is ever in flight, see RemoveOffscreenProjectiles
+        projectiles.reserve(GRID_WIDTH * GRID_HEIGHT);
+        enemies.reserve(ENEMY_RESERVE);
+
+        if (this->spawner->Peek() == nullptr) {
+            gameOver = true;
+            victorious = true;
+        }
+    }
+
+    Game(const Game&) = delete;
+    Game& operator=(const Game&) = delete;
+
+    ~Game() {
+        for (int i = 0; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                delete map[i][j].entity;
+            }
+            free(map[i]);
+        }
+        free(map);
+    }
+
+    void Update(double frameDeltaMs) {
+        gameClock += frameDeltaMs;
+        tick++;
+
+        UpdateSpawning(frameDeltaMs);
+        UpdateEntities(frameDeltaMs);
+        UpdateEnemies(frameDeltaMs);
+        UpdateProjectiles(frameDeltaMs);
+        ResolveEnemyContacts();
+
+        // Consumers that belong to the simulation itself. Audio, logging etc. are up to the owner.
+        SpawnProjectiles();
+        ApplyHitsAndBreaches();
+        RemoveOffscreenProjectiles();
+
+        if (spawner->Peek() == nullptr) {
+            gameOver = true;
+            victorious = true;
+        }
+    }
+
+    static Vec2 EnemySize() {
+        return {static_cast<double>(BOX_SIZE.x) * 1.5, static_cast<double>(BOX_SIZE.y) * 0.75};
+    }
+
+    static Vec2 ProjectileSize() {
+        return {static_cast<double>(BOX_SIZE.x) / 2, static_cast<double>(BOX_SIZE.y) / 4};
+    }
+
+    static bool InGrid(int cellX, int cellY) {
+        return cellX >= 0 && cellX < GRID_WIDTH && cellY >= 0 && cellY < GRID_HEIGHT;
+    }
+
+    bool CanPlaceEntity(int cellX, int cellY, EntityType type) const {
+        if (!InGrid(cellX, cellY) || map[cellX][cellY].ground == WALL || map[cellX][cellY].entityType != NO_ENTITY) {
+            return false;
+        }
+
+        switch (type) {
+            case TURRET:
+                return balance >= config.turretValue;
+            case OBSTACLE:
+                return balance >= config.obstacleValue;
+            default:
+                return false;
+        }
+    }
+
+    // Purchases are settled immediately so two placements in one tick can't overspend
+    bool PlaceEntity(int cellX, int cellY, EntityType type) {
+        if (!CanPlaceEntity(cellX, cellY, type)) {
+            return false;
+        }
+
+        const int cost = type == TURRET ? config.turretValue : config.obstacleValue;
+        CreateEntity(cellX, cellY, type);
+        balance -= cost;
+        events.Emit(EntityPlacedEvent {type, cellX, cellY, cost});
+        return true;
+    }
+
+    bool SellEntity(int cellX, int cellY) {
+        if (!InGrid(cellX, cellY) || map[cellX][cellY].ground == WALL) {
+            return false;
+        }
+
+        const EntityType type = map[cellX][cellY].entityType;
+        int refund = 0;
+
+        switch (type) {
+            case TURRET:
+                refund = config.turretValue;
+                break;
+            case OBSTACLE:
+                refund = config.obstacleValue;
+                break;
+            default:
+                return false;
+        }
+
+        balance += refund;
+        RemoveEntity(cellX, cellY);
+        events.Emit(EntitySoldEvent {type, cellX, cellY, refund});
+        return true;
+    }
+
+    // Everything needed to carry on bit-for-bit from this point, into buffer. Config, textures and the spawn list
+    // are fixed for the lifetime of a Game and are left out, as are pending events. Snapshots only load into a
+    // Game built the same way, by the same build.
+    void SaveState(std::vector<uint8_t>& buffer) const {
+        SnapshotWriter writer(buffer);
+        writer.Write(SNAPSHOT_MAGIC);
+        writer.Write(SNAPSHOT_VERSION);
+        writer.Write(static_cast<uint32_t>(0)); // Total size, patched below
+        writer.Write(static_cast<uint8_t>(sizeof(Scalar)));
+
+        writer.Write(tick);
+        writer.Write(gameClock);
+        writer.Write(balance);
+        writer.Write(currentHighestEnemyId);
+        writer.Write(safeZoneCellsLost);
+        writer.Write(gameOver);
+        writer.Write(victorious);
+
+        // Cells first: they rarely change, so the start of consecutive snapshots deltas down to almost nothing
+        for (int i = 0; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                const Cell& cell = map[i][j];
+                writer.Write(static_cast<uint8_t>(cell.ground));
+                writer.Write(static_cast<uint8_t>(cell.entityType));
+
+                if (cell.entityType != NO_ENTITY) {
+                    writer.Write(cell.entity->timeSinceCreationMs);
+                }
+
+                if (cell.entityType == TURRET) {
+                    writer.Write(static_cast<const TurretEntity*>(cell.entity)->fireTimerMs);
+                }
+            }
+        }
+
+        writer.Write(static_cast<uint32_t>(enemies.size()));
+        for (const Enemy& enemy : enemies) {
+            writer.Write(enemy.id);
+            writer.Write(static_cast<uint8_t>(enemy.texture == textures.pickupTruck ? PICKUP : VAN));
+            writer.Write(enemy.collider);
+            writer.Write(enemy.speed);
+            writer.Write(enemy.removed);
+        }
+
+        writer.Write(static_cast<uint32_t>(projectiles.size()));
+        for (const Entity& projectile : projectiles) {
+            writer.Write(projectile.collider);
+            writer.Write(projectile.timeSinceCreationMs);
+        }
+
+        spawner->SaveState(writer);
+
+        const auto size = static_cast<uint32_t>(buffer.size());
+        memcpy(buffer.data() + SNAPSHOT_SIZE_OFFSET, &size, sizeof(size));
+    }
+
+    // Returns false, leaving the game untouched, if the header doesn't match this build. The body is trusted
+    // once the header and size check out; placed entities are only reallocated where their type changed.
+    bool LoadState(const std::vector<uint8_t>& buffer) {
+        SnapshotReader reader(buffer);
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint32_t size = 0;
+        uint8_t scalarSize = 0;
+        reader.Read(magic);
+        reader.Read(version);
+        reader.Read(size);
+        reader.Read(scalarSize);
+
+        if (reader.Failed() || magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION || size != buffer.size() || scalarSize != sizeof(Scalar)) {
+            return false;
+        }
+
+        reader.Read(tick);
+        reader.Read(gameClock);
+        reader.Read(balance);
+        reader.Read(currentHighestEnemyId);
+        reader.Read(safeZoneCellsLost);
+        reader.Read(gameOver);
+        reader.Read(victorious);
+
+        for (int i = 0; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                Cell& cell = map[i][j];
+                uint8_t ground = 0;
+                uint8_t entityType = 0;
+                reader.Read(ground);
+                reader.Read(entityType);
+                cell.ground = static_cast<GroundType>(ground);
+
+                if (cell.entityType != static_cast<EntityType>(entityType)) {
+                    RemoveEntity(i, j);
+                    if (entityType != NO_ENTITY) {
+                        CreateEntity(i, j, static_cast<EntityType>(entityType));
+                    }
+                }
+
+                if (cell.entityType != NO_ENTITY) {
+                    reader.Read(cell.entity->timeSinceCreationMs);
+                }
+
+                if (cell.entityType == TURRET) {
+                    reader.Read(static_cast<TurretEntity*>(cell.entity)->fireTimerMs);
+                }
+            }
+        }
+
+        uint32_t enemyCount = 0;
+        reader.Read(enemyCount);
+        enemies.clear();
+        for (uint32_t i = 0; i < enemyCount && !reader.Failed(); i++) {
+            int id = 0;
+            uint8_t type = 0;
+            BoxCollider collider;
+            Scalar speed = 0;
+            bool removed = false;
+            reader.Read(id);
+            reader.Read(type);
+            reader.Read(collider);
+            reader.Read(speed);
+            reader.Read(removed);
+
+            enemies.emplace_back(id, type == PICKUP ? textures.pickupTruck : textures.van, collider, speed);
+            enemies.back().removed = removed;
+        }
+
+        uint32_t projectileCount = 0;
+        reader.Read(projectileCount);
+        projectiles.clear();
+        for (uint32_t i = 0; i < projectileCount && !reader.Failed(); i++) {
+            BoxCollider collider;
+            double timeSinceCreationMs = 0.0;
+            reader.Read(collider);
+            reader.Read(timeSinceCreationMs);
+
+            projectiles.emplace_back(collider.pos, collider.bounds, textures.projectile);
+            projectiles.back().timeSinceCreationMs = timeSinceCreationMs;
+        }
+
+        return spawner->LoadState(reader) && !reader.Failed() && reader.AtEnd();
+    }
+
+private:
+    // Everything due this step, each placed as if it had entered exactly on time: the enemy update that follows moves
+    // it by the whole step, so it starts that much behind the spawn point. Keeps waves the same at any step size.
+    void UpdateSpawning(double frameDeltaMs) {
+        const double stepStartMs = gameClock - frameDeltaMs;
+
+        for (const EnemySpawn* nextEnemySpawn = spawner->Peek(); nextEnemySpawn != nullptr && gameClock >= nextEnemySpawn->spawnTime;
+             nextEnemySpawn = spawner->Peek()) {
+            const Vec2 pos {-25, nextEnemySpawn->startY};
+            const Vec2 size = EnemySize();
+            const double speed = config.enemySpeed * nextEnemySpawn->speedScale;
+            const Vec2 stepStartPos {pos.x + Scalar(stepStartMs - nextEnemySpawn->spawnTime) * Scalar(speed), pos.y};
+            SDL_Texture* texture = nextEnemySpawn->type == VAN ? textures.van : textures.pickupTruck;
+
+            enemies.emplace_back(currentHighestEnemyId, texture, BoxCollider(stepStartPos, size), speed);
+            events.Emit(EnemySpawnedEvent {currentHighestEnemyId, nextEnemySpawn->type, pos});
+            currentHighestEnemyId++;
+
+            spawner->Pop();
+        }
+    }
+
+    void UpdateEntities(double frameDeltaMs) {
+        for (int i = 0; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                Cell& cell = map[i][j];
+                if (cell.entityType == NO_ENTITY) {
+                    continue;
+                }
+
+                cell.entity->Update(frameDeltaMs);
+
+                if (cell.entityType == TURRET) {
+                    auto* turret = static_cast<TurretEntity*>(cell.entity);
+                    if (turret->ConsumeShot()) {
+                        events.Emit(TurretFiredEvent {i, j, turret->ProjectilePos(ProjectileSize())});
+                    }
+                }
+            }
+        }
+    }
+
+    // Collisions are swept along each body's whole path this step, so long steps can't carry anything through
+    // something else. Contacts with placed entities and the wall are only noted here and applied once projectiles
+    // have moved too, so whichever reaches an enemy first within the step gets it.
+    void UpdateEnemies(double frameDeltaMs) {
+        for (Enemy& enemy : enemies) {
+            enemy.Update(frameDeltaMs);
+            if (enemy.removed) {
+                continue;
+            }
+
+            Scalar time = 0;
+            if (enemy.stepStart.Sweep(enemy.stepMotion, wallCollider, time)) {
+                enemy.SetContact(time, -1, -1);
+            }
+
+            // Only the cells the swept box covers, plus one either side for touching edges
+            const BoxCollider& start = enemy.stepStart;
+            const Scalar minX = enemy.stepMotion.x < 0 ? start.pos.x + enemy.stepMotion.x : start.pos.x;
+            const Scalar maxX = enemy.stepMotion.x > 0 ? start.pos.x + start.bounds.x + enemy.stepMotion.x : start.pos.x + start.bounds.x;
+            const int firstColumn = std::max(0, static_cast<int>(minX) / BOX_SIZE.x - 1);
+            const int lastColumn = std::min(GRID_WIDTH - 1, static_cast<int>(maxX) / BOX_SIZE.x + 1);
+            const int firstRow = std::max(0, static_cast<int>(start.pos.y) / BOX_SIZE.y - 1);
+            const int lastRow = std::min(GRID_HEIGHT - 1, static_cast<int>(start.pos.y + start.bounds.y) / BOX_SIZE.y + 1);
+
+            for (int i = firstColumn; i <= lastColumn; i++) {
+                for (int j = firstRow; j <= lastRow; j++) {
+                    const Cell& cell = map[i][j];
+                    if (cell.entityType != NO_ENTITY && start.Sweep(enemy.stepMotion, cell.entity->collider, time)) {
+                        enemy.SetContact(time, i, j);
+                    }
+                }
+            }
+        }
+    }
+
+    void UpdateProjectiles(double frameDeltaMs) {
+        const Vec2 motion {-Scalar(frameDeltaMs), 0};
+
+        for (Entity& projectile : projectiles) {
+            projectile.Update(frameDeltaMs);
+            const BoxCollider start = projectile.collider;
+            projectile.collider.pos.x -= frameDeltaMs;
+
+            for (Enemy& enemy : enemies) {
+                Scalar time = 0;
+                if (enemy.removed || !start.Sweep(motion, enemy.stepStart, enemy.stepMotion, time)) {
+                    continue;
+                }
+
+                if (!enemy.contactPending || time <= enemy.contactTime) {
+                    enemy.removed = true;
+                    events.Emit(EnemyHitEvent {enemy.id, enemy.PositionAt(time), -1, -1});
+                }
+            }
+        }
+    }
+
+    void ResolveEnemyContacts() {
+        for (Enemy& enemy : enemies) {
+            if (enemy.removed || !enemy.contactPending) {
+                continue;
+            }
+
+            enemy.removed = true;
+            if (enemy.contactCellX >= 0) {
+                events.Emit(EnemyHitEvent {enemy.id, enemy.PositionAt(enemy.contactTime), enemy.contactCellX, enemy.contactCellY});
+            } else {
+                events.Emit(WallBreachEvent {enemy.id, enemy.PositionAt(enemy.contactTime)});
+            }
+        }
+    }
+
+    void SpawnProjectiles() {
+        for (const TurretFiredEvent& fired : events.Get<TurretFiredEvent>()) {
+            projectiles.emplace_back(fired.projectilePos, ProjectileSize(), textures.projectile);
+        }
+    }
+
+    void ApplyHitsAndBreaches() {
+        for (const EnemyHitEvent& hit : events.Get<EnemyHitEvent>()) {
+            balance += 1;
+            if (hit.cellX >= 0) {
+                RemoveEntity(hit.cellX, hit.cellY);
+            }
+        }
+
+        for ([[maybe_unused]] const WallBreachEvent& breach : events.Get<WallBreachEvent>()) {
+            balance += 1;
+
+            // Lose four spaces
+            for (int i = 0; i < 4; i++) {
+                if (!SetNextSafeZoneCellToParkingLot()) {
+                    gameOver = true;
+                }
+            }
+        }
+
+        auto newEnd = std::remove_if(enemies.begin(), enemies.end(),
+                                     [](const Enemy& enemy) {
+                                         return enemy.removed;
+                                     });
+
+        enemies.erase(newEnd, enemies.end());
+    }
+
+    // Projectiles only travel left, and nothing can be hit once a projectile is past the enemy spawn point
+    void RemoveOffscreenProjectiles() {
+        auto newEnd = std::remove_if(projectiles.begin(), projectiles.end(),
+                                     [](const Entity& projectile) {
+                                         return projectile.collider.pos.x + projectile.collider.bounds.x < -BOX_SIZE.x;
+                                     });
+
+        projectiles.erase(newEnd, projectiles.end());
+    }
+
+    void CreateEntity(int cellX, int cellY, EntityType type) {
+        Cell& cell = map[cellX][cellY];
+        const Vec2 cellPos {static_cast<double>(cellX * BOX_SIZE.x), static_cast<double>(cellY * BOX_SIZE.y)};
+        const Vec2 cellSize {static_cast<double>(BOX_SIZE.x), static_cast<double>(BOX_SIZE.y)};
+
+        if (type == TURRET) {
+            cell.entity = new TurretEntity(cellPos, cellSize, textures.turret);
+        } else {
+            cell.entity = new Entity(cellPos, cellSize, textures.obstacle);
+        }
+
+        cell.entityType = type;
+    }
+
+    void RemoveEntity(int cellX, int cellY) {
+        Cell& cell = map[cellX][cellY];
+        if (cell.entityType != NO_ENTITY) {
+            delete cell.entity;
+            cell.entity = nullptr;
+            cell.entityType = NO_ENTITY;
+        }
+    }
+
+    bool SetNextSafeZoneCellToParkingLot() {
+        for (int i = 0; i < GRID_WIDTH; i++) {
+            for (int j = 0; j < GRID_HEIGHT; j++) {
+                if (map[i][j].ground == SAFE_ZONE) {
+                    map[i][j].ground = PARKING_LOT;
+                    safeZoneCellsLost++;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+};
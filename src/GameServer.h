@@ -0,0 +1,410 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Game.h"
+#include "RingQueue.h"
+#include "Simulation.h"
+#include "Snapshot.h"
+#include "Socket.h"
+
+// Wire format, little endian as in memory like snapshots, so server and clients must be the same build.
+//   JOIN      u8 type, u32 nonce
+//   JOINED    u8 type, u32 nonce, u32 session
+//   INPUT     u8 type, u32 session, ClientInput
+//   SNAPSHOT  u8 type, u32 session, i64 tick, i64 base tick (-1 = full), u32 last input, u64 last input time,
+//             u32 payload size, payload (a Game::SaveState, or a delta of one against the base tick)
+enum PacketType : uint8_t {
+    PACKET_JOIN,
+    PACKET_JOINED,
+    PACKET_INPUT,
+    PACKET_SNAPSHOT
+};
+
+// The network form of a SimulationCommand, plus bookkeeping. Rewind and save/load are local only and ignored.
+// Every input also acknowledges the newest snapshot the client has, so deltas can be built against it.
+struct ClientInput {
+    uint32_t sequence = 0;
+    int64_t ackTick = -1;
+    uint64_t clientTimeUs = 0;
+    uint8_t hasCommand = 0;
+    SimulationCommand command;
+};
+
+struct ServerSettings {
+    int sessions = 64;
+    int threads = 0;            // 0 = all cores
+    uint16_t port = 27054;      // 0 = any free port
+    int snapshotInterval = 3;   // Simulation ticks per snapshot, 3 = 20 per second
+    double idleTimeoutMs = 10000.0; // A session that sends no input for this long is freed for the next client
+};
+
+struct ServerStats {
+    unsigned long long sessionTicks = 0;
+    unsigned long long busyNs = 0;
+    unsigned long long lateTicks = 0;
+    unsigned long long snapshotsSent = 0;
+    unsigned long long fullSnapshotsSent = 0;
+    unsigned long long snapshotBytes = 0;
+    unsigned long long sessionsTimedOut = 0;
+};
+
+// Runs many independent Games in one process, each driven by one remote client over UDP. One thread receives
+// and routes packets, a pool of workers each owns a fixed share of the sessions and steps them at the
+// simulation rate, sending each client a snapshot delta against the newest state it has acknowledged. A finished
+// game stops being stepped, and a session whose client goes quiet is reset and handed to the next one to join.
+class GameServer {
+public:
+    static constexpr size_t MAX_PACKET_BYTES = 64 * 1024;
+
+private:
+    // Full states kept per session to build deltas against. A client acking something older gets a full snapshot.
+    static constexpr int HISTORY = 32;
+
+    using Clock = std::chrono::steady_clock;
+
+    // Only the receive thread sets connected and only the owning worker clears it, after resetting the session
+    struct Session {
+        std::unique_ptr<Game> game;
+        RingQueue<ClientInput, 64> inputs;
+        SocketAddress client;
+        std::atomic<bool> connected {false};
+        Clock::time_point lastInputTime {};
+
+        std::vector<uint8_t> history[HISTORY];
+        int64_t historyTicks[HISTORY];
+        int64_t ackTick = -1;
+        uint32_t lastInputSequence = 0;
+        uint64_t lastInputClientTimeUs = 0;
+    };
+
+    struct alignas(64) WorkerStats {
+        std::atomic<unsigned long long> sessionTicks {0};
+        std::atomic<unsigned long long> busyNs {0};
+        std::atomic<unsigned long long> lateTicks {0};
+        std::atomic<unsigned long long> snapshotsSent {0};
+        std::atomic<unsigned long long> fullSnapshotsSent {0};
+        std::atomic<unsigned long long> snapshotBytes {0};
+        std::atomic<unsigned long long> sessionsTimedOut {0};
+    };
+
+    ServerSettings settings;
+    std::function<std::unique_ptr<Game>(int)> makeGame;
+    UdpSocket socket;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::unique_ptr<WorkerStats[]> workerStats;
+    std::atomic<bool> running {false};
+    std::thread receiveThread;
+    std::vector<std::thread> workers;
+
+public:
+    // makeGame builds session i's world; every client must be able to build the same one to decode snapshots. It is
+    // called again from worker threads to reset a timed out session, so it must stay valid and be thread safe.
+    GameServer(const ServerSettings& settings, const std::function<std::unique_ptr<Game>(int)>& makeGame)
+            : settings(settings), makeGame(makeGame) {
+        if (this->settings.threads <= 0) {
+            this->settings.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        for (int i = 0; i < settings.sessions; i++) {
+            auto session = std::make_unique<Session>();
+            session->game = makeGame(i);
+            for (int j = 0; j < HISTORY; j++) {
+                session->history[j].reserve(8 * 1024);
+                session->historyTicks[j] = -1;
+            }
+            sessions.push_back(std::move(session));
+        }
+
+        workerStats = std::make_unique<WorkerStats[]>(this->settings.threads);
+    }
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    ~GameServer() {
+        Stop();
+    }
+
+    bool Start() {
+        if (!socket.Bind(SocketAddress::Loopback(settings.port), 8 << 20)) {
+            return false;
+        }
+
+        running = true;
+        receiveThread = std::thread([this] { Receive(); });
+        for (int i = 0; i < settings.threads; i++) {
+            workers.emplace_back([this, i] { Work(i); });
+        }
+        return true;
+    }
+
+    void Stop() {
+        if (!running) {
+            return;
+        }
+
+        running = false;
+        receiveThread.join();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        socket.Close();
+    }
+
+    uint16_t Port() const {
+        return socket.LocalAddress().Port();
+    }
+
+    int Threads() const {
+        return settings.threads;
+    }
+
+    int ConnectedSessions() const {
+        return static_cast<int>(std::count_if(sessions.begin(), sessions.end(), [](const std::unique_ptr<Session>& session) {
+            return session->connected.load(std::memory_order_acquire);
+        }));
+    }
+
+    ServerStats Stats() const {
+        ServerStats total;
+        for (int i = 0; i < settings.threads; i++) {
+            total.sessionTicks += workerStats[i].sessionTicks;
+            total.busyNs += workerStats[i].busyNs;
+            total.lateTicks += workerStats[i].lateTicks;
+            total.snapshotsSent += workerStats[i].snapshotsSent;
+            total.fullSnapshotsSent += workerStats[i].fullSnapshotsSent;
+            total.snapshotBytes += workerStats[i].snapshotBytes;
+            total.sessionsTimedOut += workerStats[i].sessionsTimedOut;
+        }
+        return total;
+    }
+
+private:
+    void Receive() {
+        std::vector<uint8_t> packet(MAX_PACKET_BYTES);
+        std::vector<uint8_t> reply;
+        reply.reserve(64);
+
+        while (running) {
+            SocketAddress from;
+            const int size = socket.ReceiveFrom(packet.data(), packet.size(), from, 10);
+            if (size <= 0) {
+                continue;
+            }
+
+            SnapshotReader reader(packet.data(), static_cast<size_t>(size));
+            uint8_t type = 0;
+            reader.Read(type);
+
+            if (type == PACKET_JOIN) {
+                uint32_t nonce = 0;
+                if (!reader.Read(nonce)) {
+                    continue;
+                }
+
+                const uint32_t sessionId = FindOrAssignSession(from);
+                if (sessionId == UINT32_MAX) {
+                    continue;
+                }
+
+                SnapshotWriter writer(reply);
+                writer.Write(static_cast<uint8_t>(PACKET_JOINED));
+                writer.Write(nonce);
+                writer.Write(sessionId);
+                socket.SendTo(from, reply.data(), reply.size());
+            } else if (type == PACKET_INPUT) {
+                uint32_t sessionId = 0;
+                ClientInput input;
+                if (!reader.Read(sessionId) || !reader.Read(input) || sessionId >= sessions.size()) {
+                    continue;
+                }
+
+                // Only the client that joined a session may drive it
+                Session& session = *sessions[sessionId];
+                if (session.connected.load(std::memory_order_acquire) && session.client == from) {
+                    session.inputs.Push(input);
+                }
+            }
+        }
+    }
+
+    // A repeated JOIN, e.g. after a lost JOINED, gets the same session back
+    uint32_t FindOrAssignSession(const SocketAddress& from) {
+        for (size_t i = 0; i < sessions.size(); i++) {
+            if (sessions[i]->connected.load(std::memory_order_acquire) && sessions[i]->client == from) {
+                return static_cast<uint32_t>(i);
+            }
+        }
+
+        for (size_t i = 0; i < sessions.size(); i++) {
+            Session& session = *sessions[i];
+            if (session.connected.load(std::memory_order_acquire)) {
+                continue;
+            }
+
+            // Inputs from the previous client that arrived while its session was being reset
+            ClientInput stale;
+            while (session.inputs.Pop(stale)) {}
+
+            session.client = from;
+            session.connected.store(true, std::memory_order_release);
+            return static_cast<uint32_t>(i);
+        }
+
+        return UINT32_MAX;
+    }
+
+    void Work(int workerIndex) {
+        const auto step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(Simulation::STEP_MS));
+        const auto idleTimeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(settings.idleTimeoutMs));
+        WorkerStats& stats = workerStats[workerIndex];
+        unsigned long long rounds = 0;
+
+        std::vector<uint8_t> delta;
+        std::vector<uint8_t> packet;
+        delta.reserve(8 * 1024);
+        packet.reserve(MAX_PACKET_BYTES);
+
+        auto nextTick = Clock::now();
+        while (running) {
+            const auto tickStart = Clock::now();
+            unsigned long long ticked = 0;
+            rounds++;
+
+            for (size_t i = static_cast<size_t>(workerIndex); i < sessions.size(); i += static_cast<size_t>(settings.threads)) {
+                Session& session = *sessions[i];
+                if (!session.connected.load(std::memory_order_acquire)) {
+                    continue;
+                }
+
+                // A new client's clock starts when its session is first stepped
+                if (ApplyInputs(session) || session.lastInputTime == Clock::time_point()) {
+                    session.lastInputTime = tickStart;
+                }
+
+                if (tickStart - session.lastInputTime > idleTimeout) {
+                    ResetSession(static_cast<int>(i), session);
+                    stats.sessionsTimedOut++;
+                    continue;
+                }
+
+                Game& game = *session.game;
+                if (!game.gameOver) {
+                    game.Update(Simulation::STEP_MS);
+                    game.events.Clear();
+                    ticked++;
+
+                    // The tick the game ended on always goes out, it's the last state there will be
+                    if (game.tick % settings.snapshotInterval == 0 || game.gameOver) {
+                        SendSnapshot(static_cast<uint32_t>(i), session, delta, packet, stats);
+                    }
+                } else if (session.ackTick < game.tick && rounds % static_cast<unsigned long long>(settings.snapshotInterval) == 0) {
+                    // Resent at the snapshot rate until the client has it
+                    SendSnapshot(static_cast<uint32_t>(i), session, delta, packet, stats);
+                }
+            }
+
+            const auto tickEnd = Clock::now();
+            stats.sessionTicks += ticked;
+            stats.busyNs += static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(tickEnd - tickStart).count());
+
+            nextTick += step;
+            if (tickEnd > nextTick) {
+                // Fell behind: count it and carry on from now rather than bursting to catch up
+                stats.lateTicks++;
+                nextTick = tickEnd;
+            } else {
+                std::this_thread::sleep_until(nextTick);
+            }
+        }
+    }
+
+    // Returns whether anything arrived from the client
+    static bool ApplyInputs(Session& session) {
+        bool received = false;
+        ClientInput input;
+        while (session.inputs.Pop(input)) {
+            received = true;
+            session.ackTick = std::max(session.ackTick, input.ackTick);
+
+            // Resent or reordered inputs are applied once, in order
+            if (input.hasCommand == 0 || input.sequence <= session.lastInputSequence) {
+                continue;
+            }
+
+            session.lastInputSequence = input.sequence;
+            session.lastInputClientTimeUs = input.clientTimeUs;
+
+            Game& game = *session.game;
+            switch (input.command.type) {
+                case COMMAND_PLACE_ENTITY:
+                    game.PlaceEntity(input.command.cellX, input.command.cellY, input.command.entityType);
+                    break;
+                case COMMAND_SELL_ENTITY:
+                    game.SellEntity(input.command.cellX, input.command.cellY);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        return received;
+    }
+
+    // Worker thread. Puts the session back as it was built, then frees it for FindOrAssignSession.
+    void ResetSession(int sessionId, Session& session) {
+        session.game = makeGame(sessionId);
+        for (int64_t& historyTick : session.historyTicks) {
+            historyTick = -1;
+        }
+        session.ackTick = -1;
+        session.lastInputSequence = 0;
+        session.lastInputClientTimeUs = 0;
+        session.lastInputTime = Clock::time_point();
+        session.connected.store(false, std::memory_order_release);
+    }
+
+    void SendSnapshot(uint32_t sessionId, Session& session, std::vector<uint8_t>& delta, std::vector<uint8_t>& packet, WorkerStats& stats) {
+        const int64_t tick = session.game->tick;
+        const int slot = static_cast<int>((tick / settings.snapshotInterval) % HISTORY);
+        session.game->SaveState(session.history[slot]);
+        session.historyTicks[slot] = tick;
+
+        int64_t baseTick = -1;
+        if (session.ackTick >= 0) {
+            const int ackSlot = static_cast<int>((session.ackTick / settings.snapshotInterval) % HISTORY);
+            if (session.historyTicks[ackSlot] == session.ackTick && ackSlot != slot) {
+                baseTick = session.ackTick;
+                EncodeSnapshotDelta(session.history[ackSlot], session.history[slot], delta);
+            }
+        }
+
+        const std::vector<uint8_t>& payload = baseTick >= 0 ? delta : session.history[slot];
+
+        SnapshotWriter writer(packet);
+        writer.Write(static_cast<uint8_t>(PACKET_SNAPSHOT));
+        writer.Write(sessionId);
+        writer.Write(tick);
+        writer.Write(baseTick);
+        writer.Write(session.lastInputSequence);
+        writer.Write(session.lastInputClientTimeUs);
+        writer.Write(static_cast<uint32_t>(payload.size()));
+        writer.WriteBytes(payload.data(), payload.size());
+
+        if (packet.size() <= MAX_PACKET_BYTES && socket.SendTo(session.client, packet.data(), packet.size())) {
+            stats.snapshotsSent++;
+            stats.snapshotBytes += packet.size();
+            if (baseTick < 0) {
+                stats.fullSnapshotsSent++;
+            }
+        }
+    }
+};
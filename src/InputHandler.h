@@ -7,6 +7,9 @@ class InputHandler {
 public:
     struct State {
         Vec2Int mousePos {0, 0};
+        bool mouseMovedThisFrame = false;
+        Uint32 mouseMovedTime = 0;          // SDL_GetTicks time of the newest motion mousePos reflects
+        Uint32 leftMousePressedTime = 0;    // SDL_GetTicks time of the last left click
         bool leftMousePressedThisFrame = false;
         bool leftMousePressed = false;
         bool rightMousePressedThisFrame = false;
@@ -20,20 +23,35 @@ public:
         bool downKeyPressed = false;
         bool leftKeyPressed = false;
         bool rightKeyPressed = false;
+        bool backspaceKeyPressed = false;
+        bool f5KeyPressedThisFrame = false;
+        bool f9KeyPressedThisFrame = false;
+        bool f10KeyPressedThisFrame = false;
+        int numberKeyPressedThisFrame = 0; // 1-9, 0 if none
 
     };
 
     State state;
 
 private:
+    static constexpr int MAX_PEEKED_MOTIONS = 64;
+
     SDL_Event eventData{};
+    SDL_Event peekedMotions[MAX_PEEKED_MOTIONS] {};
+    // Motion events up to this timestamp were already reported by RefreshMousePosition
+    Uint32 reportedMotionTime = 0;
 
 public:
     InputHandler() = default;
 
     void Update() {
+        state.mouseMovedThisFrame = false;
         state.leftMousePressedThisFrame = false;
         state.rightMousePressedThisFrame = false;
+        state.f5KeyPressedThisFrame = false;
+        state.f9KeyPressedThisFrame = false;
+        state.f10KeyPressedThisFrame = false;
+        state.numberKeyPressedThisFrame = 0;
 
         while (SDL_PollEvent(&eventData))
         {
@@ -41,12 +59,17 @@ public:
             {
                 case SDL_MOUSEMOTION:
                     state.mousePos = {eventData.button.x, eventData.button.y};
+                    if (eventData.motion.timestamp > reportedMotionTime) {
+                        state.mouseMovedThisFrame = true;
+                        state.mouseMovedTime = eventData.motion.timestamp;
+                    }
                     break;
 
                 case SDL_MOUSEBUTTONDOWN:
                     if (eventData.button.button == SDL_BUTTON_LEFT) {
                         state.leftMousePressedThisFrame = true;
                         state.leftMousePressed = true;
+                        state.leftMousePressedTime = eventData.button.timestamp;
                     } else if (eventData.button.button == SDL_BUTTON_RIGHT) {
                         state.rightMousePressedThisFrame = true;
                         state.rightMousePressed = true;
@@ -92,6 +115,29 @@ public:
                         case SDLK_RIGHT:
                             state.rightKeyPressed = true;
                             break;
+                        case SDLK_BACKSPACE:
+                            state.backspaceKeyPressed = true;
+                            break;
+                        case SDLK_F5:
+                            state.f5KeyPressedThisFrame = true;
+                            break;
+                        case SDLK_F9:
+                            state.f9KeyPressedThisFrame = true;
+                            break;
+                        case SDLK_F10:
+                            state.f10KeyPressedThisFrame = true;
+                            break;
+                        case SDLK_1:
+                        case SDLK_2:
+                        case SDLK_3:
+                        case SDLK_4:
+                        case SDLK_5:
+                        case SDLK_6:
+                        case SDLK_7:
+                        case SDLK_8:
+                        case SDLK_9:
+                            state.numberKeyPressedThisFrame = eventData.key.keysym.sym - SDLK_0;
+                            break;
                         default:
                             break;
                     }
@@ -123,6 +169,9 @@ public:
                         case SDLK_RIGHT:
                             state.rightKeyPressed = false;
                             break;
+                        case SDLK_BACKSPACE:
+                            state.backspaceKeyPressed = false;
+                            break;
                         default:
                             break;
                     }
@@ -130,4 +179,31 @@ public:
             }
         }
     }
-};
\ No newline at end of file
+
+    // Reads where the mouse is right now, for drawing the cursor as late in the frame as possible. Clicks and keys
+    // stay queued for the next Update, and the motion events covered here aren't reported again when it drains
+    // them. Returns whether the position changed.
+    bool RefreshMousePosition() {
+        SDL_PumpEvents();
+        int x = 0;
+        int y = 0;
+        SDL_GetMouseState(&x, &y);
+        if (x == state.mousePos.x && y == state.mousePos.y) {
+            return false;
+        }
+
+        state.mousePos = {x, y};
+        state.mouseMovedThisFrame = true;
+
+        // Timed from the newest queued motion. With more queued than fit, the newest that fit stands in, which
+        // overstates the latency slightly. Only the rare move SDL reports without an event falls back to now.
+        const int peeked = SDL_PeepEvents(peekedMotions, MAX_PEEKED_MOTIONS, SDL_PEEKEVENT, SDL_MOUSEMOTION, SDL_MOUSEMOTION);
+        if (peeked > 0) {
+            state.mouseMovedTime = peekedMotions[peeked - 1].motion.timestamp;
+            reportedMotionTime = state.mouseMovedTime;
+        } else {
+            state.mouseMovedTime = SDL_GetTicks();
+        }
+        return true;
+    }
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+
+// Latencies in whole milliseconds, counted into fixed buckets so adding one never allocates. Anything at or over
+// the last bucket is counted there and only the maximum keeps its real value.
+class LatencyHistogram {
+public:
+    static constexpr int BUCKETS = 128;
+
+private:
+    const char* name;
+    unsigned long long counts[BUCKETS] {};
+    unsigned long long total = 0;
+    unsigned long long sumMs = 0;
+    unsigned long long maxMs = 0;
+
+public:
+    explicit LatencyHistogram(const char* name) : name(name) {}
+
+    void Add(unsigned long long ms) {
+        counts[std::min(ms, static_cast<unsigned long long>(BUCKETS - 1))]++;
+        total++;
+        sumMs += ms;
+        maxMs = std::max(maxMs, ms);
+    }
+
+    unsigned long long Count() const {
+        return total;
+    }
+
+    double MeanMs() const {
+        return total > 0 ? static_cast<double>(sumMs) / static_cast<double>(total) : 0.0;
+    }
+
+    // Smallest latency at least a fraction p of the samples were at or under
+    unsigned long long PercentileMs(double p) const {
+        const auto rank = static_cast<unsigned long long>(p * static_cast<double>(total));
+        unsigned long long seen = 0;
+        for (int i = 0; i < BUCKETS - 1; i++) {
+            seen += counts[i];
+            if (seen > rank || (seen == total && total > 0)) {
+                return static_cast<unsigned long long>(i);
+            }
+        }
+        return maxMs;
+    }
+
+    void PrintReport(std::ostream& out) const {
+        out << name << ": " << total << " samples";
+        if (total == 0) {
+            out << std::endl;
+            return;
+        }
+
+        out << ", ms mean/p50/p95/p99/max: " << std::fixed << std::setprecision(1) << MeanMs() << " / " << PercentileMs(0.5)
+            << " / " << PercentileMs(0.95) << " / " << PercentileMs(0.99) << " / " << maxMs << std::endl;
+
+        // One bar per 4 ms up to the maximum, scaled to the fullest
+        const int shown = static_cast<int>(std::min(maxMs, static_cast<unsigned long long>(BUCKETS - 1))) / 4 + 1;
+        unsigned long long fullest = 1;
+        for (int i = 0; i < shown; i++) {
+            fullest = std::max(fullest, BucketSum(i));
+        }
+
+        for (int i = 0; i < shown; i++) {
+            const unsigned long long count = BucketSum(i);
+            const int width = static_cast<int>(count * 40 / fullest);
+            out << "  " << std::setw(3) << i * 4 << (i * 4 + 4 >= BUCKETS ? "+ " : "  ") << std::string(width, '#') << " " << count << std::endl;
+        }
+    }
+
+private:
+    unsigned long long BucketSum(int group) const {
+        unsigned long long sum = 0;
+        for (int i = group * 4; i < std::min(group * 4 + 4, BUCKETS); i++) {
+            sum += counts[i];
+        }
+        return sum;
+    }
+};
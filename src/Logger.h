@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "RingQueue.h"
+
+enum LogLevel {
+    LOG_DEBUG,
+    LOG_INFO,
+    LOG_WARNING,
+    LOG_ERROR
+};
+
+// Anything below this level is compiled out entirely
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_INFO
+#endif
+
+struct LogFields {
+    long long tick = -1;
+    int enemyId = -1;
+    double x = 0.0;
+    double y = 0.0;
+};
+
+class Logger {
+public:
+    struct Record {
+        LogLevel level;
+        const char* message; // Must be a string literal, only the pointer is queued
+        LogFields fields;
+    };
+
+private:
+    static constexpr size_t QUEUE_CAPACITY = 4096;
+
+    RingQueue<Record, QUEUE_CAPACITY> queue;
+    std::atomic<bool> running {true};
+    std::atomic<unsigned long long> droppedCount {0};
+    std::thread drainThread;
+
+public:
+    Logger() : drainThread([this] { Drain(); }) {}
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    ~Logger() {
+        running = false;
+        drainThread.join();
+
+        if (droppedCount > 0) {
+            std::cout << "Logger dropped " << droppedCount << " records" << std::endl;
+        }
+    }
+
+    // Safe to call from the simulation thread: never blocks, never allocates. Drops the record if the queue is full.
+    template<LogLevel level>
+    void Log(const char* message, const LogFields& fields = {}) {
+        if constexpr (level >= LOG_MIN_LEVEL) {
+            if (!queue.Push({level, message, fields})) {
+                droppedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    static const char* LevelName(LogLevel level) {
+        switch (level) {
+            case LOG_DEBUG:
+                return "DEBUG";
+            case LOG_INFO:
+                return "INFO";
+            case LOG_WARNING:
+                return "WARNING";
+            case LOG_ERROR:
+                return "ERROR";
+        }
+
+        return "";
+    }
+
+    void Write(const Record& record) {
+        std::cout << "[" << LevelName(record.level) << "] " << record.message;
+
+        if (record.fields.tick >= 0) {
+            std::cout << " tick=" << record.fields.tick;
+        }
+
+        if (record.fields.enemyId >= 0) {
+            std::cout << " enemy=" << record.fields.enemyId << " pos=(" << record.fields.x << ", " << record.fields.y << ")";
+        }
+
+        std::cout << '\n';
+    }
+
+    void Drain() {
+        Record record {};
+
+        while (true) {
+            bool wroteAny = false;
+            while (queue.Pop(record)) {
+                Write(record);
+                wroteAny = true;
+            }
+
+            if (wroteAny) {
+                std::cout.flush();
+            }
+
+            if (!running) {
+                // Pick up anything pushed between the last pop and the shutdown request
+                while (queue.Pop(record)) {
+                    Write(record);
+                }
+                std::cout.flush();
+                return;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+};
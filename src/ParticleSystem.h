@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "SDL.h"
+#include "EnemySpawner.h"
+#include "RenderQueue.h"
+#include "Simulation.h"
+
+// Particles that share motion rules and a texture, stored as parallel arrays so a frame's integration is a few
+// straight loops over floats. Capacity is fixed up front, along with the vertex and index buffers to draw all of
+// them in one batch; spawning into a full pool drops the particle, nothing is ever allocated after construction.
+class ParticlePool {
+public:
+    struct Motion {
+        float gravity = 0.0f;   // px/ms², down
+        float drag = 0.0f;      // Fraction of velocity lost per ms
+        float shrink = 0.0f;    // Fraction of size lost over a lifetime
+    };
+
+private:
+    Motion motion;
+    size_t capacity;
+    size_t count = 0;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> vx;
+    std::vector<float> vy;
+    std::vector<float> age;
+    std::vector<float> life;
+    std::vector<float> size;
+    std::vector<SDL_Color> color;
+
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+
+public:
+    ParticlePool(const Motion& motion, size_t capacity)
+            : motion(motion), capacity(capacity),
+              x(capacity), y(capacity), vx(capacity), vy(capacity), age(capacity), life(capacity), size(capacity),
+              color(capacity), vertices(capacity * 4), indices(capacity * 6) {
+        // Two triangles per quad, the same pattern for every particle
+        for (size_t i = 0; i < capacity; i++) {
+            const int first = static_cast<int>(i * 4);
+            int* quad = &indices[i * 6];
+            quad[0] = first;
+            quad[1] = first + 1;
+            quad[2] = first + 2;
+            quad[3] = first + 2;
+            quad[4] = first + 3;
+            quad[5] = first;
+        }
+    }
+
+    ParticlePool(const ParticlePool&) = delete;
+    ParticlePool& operator=(const ParticlePool&) = delete;
+
+    size_t Count() const {
+        return count;
+    }
+
+    size_t Capacity() const {
+        return capacity;
+    }
+
+    void Clear() {
+        count = 0;
+    }
+
+    bool Spawn(float posX, float posY, float velocityX, float velocityY, float lifeMs, float sizePx, SDL_Color tint) {
+        if (count == capacity) {
+            return false;
+        }
+
+        x[count] = posX;
+        y[count] = posY;
+        vx[count] = velocityX;
+        vy[count] = velocityY;
+        age[count] = 0.0f;
+        life[count] = lifeMs;
+        size[count] = sizePx;
+        color[count] = tint;
+        count++;
+        return true;
+    }
+
+    void Update(float deltaMs) {
+        const float damping = motion.drag * deltaMs < 1.0f ? 1.0f - motion.drag * deltaMs : 0.0f;
+        const float fall = motion.gravity * deltaMs;
+        const size_t n = count;
+
+        // Kept as separate loops with no branches so the compiler can vectorise them
+        for (size_t i = 0; i < n; i++) {
+            vx[i] *= damping;
+            vy[i] = vy[i] * damping + fall;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            x[i] += vx[i] * deltaMs;
+            y[i] += vy[i] * deltaMs;
+            age[i] += deltaMs;
+        }
+
+        // Expired particles are replaced by the last live one, so the arrays stay packed
+        size_t i = 0;
+        while (i < count) {
+            if (age[i] < life[i]) {
+                i++;
+                continue;
+            }
+
+            count--;
+            x[i] = x[count];
+            y[i] = y[count];
+            vx[i] = vx[count];
+            vy[i] = vy[count];
+            age[i] = age[count];
+            life[i] = life[count];
+            size[i] = size[count];
+            color[i] = color[count];
+        }
+    }
+
+    // Builds this frame's quads and records them as one batch. They fade out and shrink over their lifetime. The
+    // texture isn't kept, so whoever owns it can destroy it without leaving the pool pointing at it.
+    void Record(RenderQueue& queue, RenderLayer layer, SDL_Texture* texture) {
+        for (size_t i = 0; i < count; i++) {
+            const float t = age[i] / life[i];
+            const float half = size[i] * (1.0f - motion.shrink * t) * 0.5f;
+            SDL_Color tint = color[i];
+            tint.a = static_cast<Uint8>(static_cast<float>(tint.a) * (1.0f - t));
+
+            SDL_Vertex* quad = &vertices[i * 4];
+            quad[0] = {{x[i] - half, y[i] - half}, tint, {0.0f, 0.0f}};
+            quad[1] = {{x[i] + half, y[i] - half}, tint, {1.0f, 0.0f}};
+            quad[2] = {{x[i] + half, y[i] + half}, tint, {1.0f, 1.0f}};
+            quad[3] = {{x[i] - half, y[i] + half}, tint, {0.0f, 1.0f}};
+        }
+
+        queue.Geometry(layer, texture, vertices.data(), static_cast<int>(count * 4), indices.data(), static_cast<int>(count * 6));
+    }
+};
+
+// Hit, explosion and breach effects for the render thread. Sparks are soft additive dots from a texture made at
+// startup, debris is untextured and falls; each is one pool and one draw per frame however many effects are live.
+class ParticleSystem {
+private:
+    static constexpr int SPARK_TEXTURE_SIZE = 16;
+
+    SDL_Texture* sparkTexture;
+    ParticlePool sparks;
+    ParticlePool debris;
+    SpawnRandom random {0x5EED};
+
+public:
+    ParticleSystem(SDL_Renderer* renderer, size_t sparkCapacity = 16384, size_t debrisCapacity = 8192)
+            : sparkTexture(CreateSparkTexture(renderer)),
+              sparks({0.0f, 0.004f, 0.5f}, sparkCapacity),
+              debris({0.0006f, 0.001f, 0.0f}, debrisCapacity) {}
+
+    ParticleSystem(const ParticleSystem&) = delete;
+    ParticleSystem& operator=(const ParticleSystem&) = delete;
+
+    ~ParticleSystem() {
+        Clear();
+    }
+
+    // Must run before the renderer is destroyed. Sparks recorded afterwards are drawn untextured.
+    void Clear() {
+        SDL_DestroyTexture(sparkTexture);
+        sparkTexture = nullptr;
+        sparks.Clear();
+        debris.Clear();
+    }
+
+    size_t Count() const {
+        return sparks.Count() + debris.Count();
+    }
+
+    void Emit(const EffectEvent& effect) {
+        switch (effect.type) {
+            case EFFECT_IMPACT:
+                Burst(sparks, effect, 24, 0.15f, 0.5f, 150.0f, 350.0f, 6.0f, 12.0f, {255, 220, 120, 255});
+                Burst(debris, effect, 6, 0.05f, 0.2f, 200.0f, 400.0f, 2.0f, 4.0f, {90, 90, 90, 255});
+                break;
+            case EFFECT_EXPLOSION:
+                Burst(sparks, effect, 48, 0.1f, 0.4f, 250.0f, 600.0f, 10.0f, 24.0f, {255, 140, 40, 255});
+                Burst(debris, effect, 16, 0.05f, 0.25f, 400.0f, 800.0f, 3.0f, 6.0f, {60, 60, 60, 255});
+                break;
+            case EFFECT_BREACH:
+                Burst(sparks, effect, 24, 0.05f, 0.25f, 300.0f, 700.0f, 12.0f, 28.0f, {255, 60, 40, 255});
+                Burst(debris, effect, 64, 0.1f, 0.35f, 500.0f, 1000.0f, 3.0f, 7.0f, {120, 100, 80, 255});
+                break;
+        }
+    }
+
+    void Update(double frameDeltaMs) {
+        sparks.Update(static_cast<float>(frameDeltaMs));
+        debris.Update(static_cast<float>(frameDeltaMs));
+    }
+
+    void Record(RenderQueue& queue, RenderLayer layer) {
+        debris.Record(queue, layer, nullptr);
+        sparks.Record(queue, layer, sparkTexture);
+    }
+
+private:
+    float Uniform(float min, float max) {
+        return static_cast<float>(random.Uniform(min, max));
+    }
+
+    void Burst(ParticlePool& pool, const EffectEvent& effect, int particles, float minSpeed, float maxSpeed,
+               float minLifeMs, float maxLifeMs, float minSize, float maxSize, SDL_Color tint) {
+        for (int i = 0; i < particles; i++) {
+            const float angle = Uniform(0.0f, 6.2831853f);
+            const float speed = Uniform(minSpeed, maxSpeed);
+            if (!pool.Spawn(effect.x, effect.y, SDL_cosf(angle) * speed, SDL_sinf(angle) * speed,
+                            Uniform(minLifeMs, maxLifeMs), Uniform(minSize, maxSize), tint)) {
+                return;
+            }
+        }
+    }
+
+    // White, fading out from the centre, added onto whatever is behind it; vertex colours tint it
+    static SDL_Texture* CreateSparkTexture(SDL_Renderer* renderer) {
+        Uint8 pixels[SPARK_TEXTURE_SIZE * SPARK_TEXTURE_SIZE * 4];
+        const float centre = (SPARK_TEXTURE_SIZE - 1) / 2.0f;
+
+        for (int j = 0; j < SPARK_TEXTURE_SIZE; j++) {
+            for (int i = 0; i < SPARK_TEXTURE_SIZE; i++) {
+                const float dx = (static_cast<float>(i) - centre) / centre;
+                const float dy = (static_cast<float>(j) - centre) / centre;
+                const float falloff = 1.0f - SDL_sqrtf(dx * dx + dy * dy);
+                Uint8* pixel = &pixels[(j * SPARK_TEXTURE_SIZE + i) * 4];
+                pixel[0] = 255;
+                pixel[1] = 255;
+                pixel[2] = 255;
+                pixel[3] = static_cast<Uint8>(falloff > 0.0f ? falloff * falloff * 255.0f : 0.0f);
+            }
+        }
+
+        SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, SPARK_TEXTURE_SIZE, SPARK_TEXTURE_SIZE);
+        if (texture != nullptr) {
+            SDL_UpdateTexture(texture, nullptr, pixels, SPARK_TEXTURE_SIZE * 4);
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_ADD);
+        }
+        return texture;
+    }
+};
@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include "Game.h"
+#include "Simulation.h"
+#include "TripleBuffer.h"
+
+struct PreviewMarker {
+    float x;
+    float y;
+    bool breach;    // Otherwise a kill
+};
+
+// What the next few seconds look like with the hovered placement, and without it
+struct PreviewResult {
+    int cellX = -1;
+    int cellY = -1;
+    EntityType type = NO_ENTITY;
+    long long tick = -1;
+    bool placeable = false;
+    int kills = 0;
+    int breaches = 0;
+    int baselineKills = 0;
+    int baselineBreaches = 0;
+    std::vector<PreviewMarker> markers;
+};
+
+// Answers "what if I put this here" while the player is still hovering. A thread of its own forks the newest game
+// state the Simulation publishes into a Game it keeps for the purpose, places the hovered entity and plays the next
+// few seconds headless, once with the placement and once without. Loading a state only reallocates entities whose
+// type changed and reuses the enemy and projectile storage, so a fork costs about as much as copying the snapshot.
+class PlacementPreview {
+public:
+    static constexpr double LOOK_AHEAD_MS = 5000.0;
+
+private:
+    // While the cursor stays put the preview follows the game at this rate
+    static constexpr double REFRESH_MS = 100.0;
+    static constexpr size_t MAX_MARKERS = 128;
+    static constexpr uint32_t NO_REQUEST = 0;
+
+    struct Outcome {
+        int kills = 0;
+        int breaches = 0;
+    };
+
+    Simulation& simulation;
+    Game fork;
+    double lookAheadMs;
+
+    std::atomic<uint32_t> request {NO_REQUEST};
+    TripleBuffer<PreviewResult> results;
+    std::atomic<bool> running {true};
+    std::thread thread;
+
+    Outcome baseline;
+    bool baselineValid = false;
+
+    unsigned long long runs = 0;
+    double forkMs = 0.0;
+    double lookAheadTotalMs = 0.0;
+    double worstMs = 0.0;
+
+public:
+    // spawner must be a clone of the simulated game's, see EnemySpawner::Clone
+    PlacementPreview(Simulation& simulation, const GameConfig& config, std::unique_ptr<EnemySpawner> spawner, double lookAheadMs = LOOK_AHEAD_MS)
+            : simulation(simulation), fork(config, GameTextures(), std::move(spawner)), lookAheadMs(lookAheadMs) {
+        thread = std::thread([this] { Run(); });
+    }
+
+    PlacementPreview(const PlacementPreview&) = delete;
+    PlacementPreview& operator=(const PlacementPreview&) = delete;
+
+    ~PlacementPreview() {
+        Stop();
+    }
+
+    void Stop() {
+        if (!running) {
+            return;
+        }
+
+        running = false;
+        thread.join();
+    }
+
+    // Render thread. NO_ENTITY stops previewing.
+    void Request(int cellX, int cellY, EntityType type) {
+        request.store(type == NO_ENTITY || !Game::InGrid(cellX, cellY) ? NO_REQUEST : PackRequest(cellX, cellY, type), std::memory_order_release);
+    }
+
+    // Render thread. Stays valid and unchanged until the next call; check it's for the cell being hovered.
+    const PreviewResult& Latest() {
+        results.Consume();
+        return results.ReadSlot();
+    }
+
+    void PrintReport(std::ostream& out) const {
+        const double count = static_cast<double>(std::max(1ull, runs));
+        out << "Placement preview: " << runs << " runs of " << std::fixed << std::setprecision(0) << lookAheadMs
+            << " ms, fork " << std::setprecision(3) << forkMs / count << " ms, look-ahead " << lookAheadTotalMs / count
+            << " ms, worst total " << worstMs << " ms" << std::endl;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static uint32_t PackRequest(int cellX, int cellY, EntityType type) {
+        return static_cast<uint32_t>(cellX) | static_cast<uint32_t>(cellY) << 8 | static_cast<uint32_t>(type) << 16;
+    }
+
+    static double MsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void Run() {
+        uint32_t lastRequest = NO_REQUEST;
+        bool stateChanged = false;
+        Clock::time_point lastRun;
+
+        while (running) {
+            if (simulation.ConsumeForkState()) {
+                stateChanged = true;
+                baselineValid = false;
+            }
+
+            const uint32_t current = request.load(std::memory_order_acquire);
+            const bool due = current != NO_REQUEST
+                    && (current != lastRequest || (stateChanged && MsSince(lastRun) >= REFRESH_MS));
+            if (!due) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            lastRequest = current;
+            stateChanged = false;
+            lastRun = Clock::now();
+            Preview(static_cast<int>(current & 0xFF), static_cast<int>(current >> 8 & 0xFF), static_cast<EntityType>(current >> 16));
+        }
+    }
+
+    void Preview(int cellX, int cellY, EntityType type) {
+        const std::vector<uint8_t>& state = simulation.ForkState();
+        const Clock::time_point start = Clock::now();
+
+        // The game without the placement only changes with the state, not with the cursor
+        if (!baselineValid) {
+            if (!fork.LoadState(state)) {
+                return;
+            }
+            fork.events.Clear();
+            baseline = LookAhead(nullptr);
+            baselineValid = true;
+        }
+
+        const Clock::time_point forkStart = Clock::now();
+        if (!fork.LoadState(state)) {
+            return;
+        }
+
+        PreviewResult& result = results.WriteSlot();
+        result.cellX = cellX;
+        result.cellY = cellY;
+        result.type = type;
+        result.tick = fork.tick;
+        result.placeable = fork.PlaceEntity(cellX, cellY, type);
+        result.markers.clear();
+        fork.events.Clear();
+        const double forkCostMs = MsSince(forkStart);
+
+        const Clock::time_point lookAheadStart = Clock::now();
+        const Outcome outcome = result.placeable ? LookAhead(&result.markers) : Outcome();
+        const double lookAheadCostMs = MsSince(lookAheadStart);
+
+        result.kills = outcome.kills;
+        result.breaches = outcome.breaches;
+        result.baselineKills = baseline.kills;
+        result.baselineBreaches = baseline.breaches;
+        results.Publish();
+
+        runs++;
+        forkMs += forkCostMs;
+        lookAheadTotalMs += lookAheadCostMs;
+        worstMs = std::max(worstMs, MsSince(start));
+    }
+
+    Outcome LookAhead(std::vector<PreviewMarker>* markers) {
+        Outcome outcome;
+        const Vec2 enemySize = Game::EnemySize();
+
+        for (double elapsedMs = 0.0; elapsedMs < lookAheadMs && !fork.gameOver; elapsedMs += Simulation::STEP_MS) {
+            fork.Update(Simulation::STEP_MS);
+
+            for (const EnemyHitEvent& hit : fork.events.Get<EnemyHitEvent>()) {
+                outcome.kills++;
+                if (markers != nullptr && markers->size() < MAX_MARKERS) {
+                    markers->push_back({static_cast<float>(hit.pos.x + enemySize.x / 2), static_cast<float>(hit.pos.y + enemySize.y / 2), false});
+                }
+            }
+
+            for (const WallBreachEvent& breach : fork.events.Get<WallBreachEvent>()) {
+                outcome.breaches++;
+                if (markers != nullptr && markers->size() < MAX_MARKERS) {
+                    markers->push_back({static_cast<float>(breach.pos.x + enemySize.x / 2), static_cast<float>(breach.pos.y + enemySize.y / 2), true});
+                }
+            }
+
+            fork.events.Clear();
+        }
+
+        return outcome;
+    }
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "SDL.h"
+#include "SDL_image.h"
+#include "SDL_ttf.h"
+#include "BalanceRunner.h"
+#include "Game.h"
+#include "RenderQueue.h"
+#include "Simulation.h"
+#include "TextCache.h"
+#include "WorldRenderer.h"
+
+struct RenderBenchSettings {
+    int frames = 300;
+    double warmupSeconds = 60.0;
+    unsigned int seed = 1;
+};
+
+struct RenderBenchResult {
+    RenderStats stats;
+    double msPerFrame = 0.0;
+};
+
+inline void PrintRenderBenchUsage() {
+    std::cout << "Usage: LD54 --render-bench [options]\n"
+                 "  --frames N           submissions to time per mode (default 300)\n"
+                 "  --seconds X          game time simulated before the frame is captured (default 60)\n"
+                 "  --seed N             endless wave seed (default 1)" << std::endl;
+}
+
+inline RenderBenchResult TimeRenderQueueSubmit(SDL_Renderer* renderer, RenderQueue& queue, int frames, bool sortByState) {
+    RenderBenchResult result;
+    const auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < frames; i++) {
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+        SDL_RenderClear(renderer);
+        queue.Submit(renderer, sortByState);
+        SDL_RenderFlush(renderer);
+    }
+
+    result.stats = queue.Stats();
+    result.msPerFrame = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+    return result;
+}
+
+inline void PrintRenderBenchRow(const char* mode, const RenderBenchResult& result) {
+    std::cout << std::setw(10) << mode
+              << std::setw(10) << result.stats.commands
+              << std::setw(10) << result.stats.sprites
+              << std::setw(8) << result.stats.texts
+              << std::setw(8) << result.stats.rects
+              << std::setw(10) << result.stats.textureChanges
+              << std::setw(10) << result.stats.colorChanges
+              << std::setw(14) << result.stats.pixelsFilled
+              << std::fixed << std::setprecision(3) << result.msPerFrame << std::endl;
+}
+
+// Plays a seeded endless game headlessly for a while, records one frame of it and replays that frame into SDL's
+// software renderer under the dummy video driver, once in recording order and once sorted. Reports draw
+// statistics, time per frame and whether both orders produce the same image.
+inline int RunRenderBenchCommand(int argc, char* argv[], const string& assetFolderPath) {
+    RenderBenchSettings settings;
+
+    try {
+        for (int i = 2; i < argc; i++) {
+            const string option = argv[i];
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(option);
+            }
+            const string value = argv[++i];
+
+            if (option == "--frames") {
+                settings.frames = std::stoi(value);
+            } else if (option == "--seconds") {
+                settings.warmupSeconds = std::stod(value);
+            } else if (option == "--seed") {
+                settings.seed = static_cast<unsigned int>(std::stoul(value));
+            } else {
+                throw std::invalid_argument(option);
+            }
+        }
+    } catch (const std::exception&) {
+        PrintRenderBenchUsage();
+        return 1;
+    }
+
+    if (settings.frames <= 0) {
+        PrintRenderBenchUsage();
+        return 1;
+    }
+
+    const int TARGET_WIDTH = 1600;
+    const int TARGET_HEIGHT = 900;
+
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        std::cout << "SDL_Init failed: " << SDL_GetError() << std::endl;
+        return 1;
+    }
+    IMG_Init(IMG_INIT_PNG);
+    TTF_Init();
+
+    SDL_Surface* target = SDL_CreateRGBSurfaceWithFormat(0, TARGET_WIDTH, TARGET_HEIGHT, 32, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Renderer* renderer = SDL_CreateSoftwareRenderer(target);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+
+    auto loadTexture = [&](const char* name) {
+        return IMG_LoadTexture(renderer, (assetFolderPath + name).c_str());
+    };
+
+    GroundTextures groundTextures;
+    groundTextures.floor = loadTexture("Floor1.png");
+    groundTextures.safeZone = loadTexture("Floor2.png");
+    groundTextures.wall = loadTexture("Wall1.png");
+    groundTextures.parkingLotEdge = loadTexture("ParkingLot1.png");
+    groundTextures.parkingLot = loadTexture("ParkingLot2.png");
+
+    GameTextures gameTextures;
+    gameTextures.turret = loadTexture("Turret.png");
+    gameTextures.obstacle = loadTexture("Obstacle1.png");
+    gameTextures.projectile = loadTexture("Projectile.png");
+    gameTextures.van = loadTexture("Van.png");
+    gameTextures.pickupTruck = loadTexture("PickupTruck.png");
+
+    TTF_Font* font = TTF_OpenFont((assetFolderPath + "Changa-Regular.ttf").c_str(), 120);
+    TextCache textCache(renderer, {255, 255, 255, 255});
+
+    // A busy mid-game frame: a mixed defence against endless waves
+    Game game(GameConfig(), gameTextures, std::make_unique<EndlessSpawner>(settings.seed));
+    std::mt19937 rng(settings.seed);
+    StrategyPlayer player(STRATEGY_MIXED, rng);
+    while (!game.gameOver && game.gameClock < settings.warmupSeconds * 1000.0) {
+        player.Act(game);
+        game.Update(Simulation::STEP_MS);
+        game.events.Clear();
+    }
+
+    RenderSnapshot view;
+    FillRenderSnapshot(game, GameEventCounts(), view);
+
+    RenderQueue queue;
+    RecordWorld(queue, view, groundTextures);
+    queue.FillRect(LAYER_UI_BACKGROUND, {128, 128, 128, 255}, {0, 0, BOX_SIZE.x * 4, GRID_HEIGHT * BOX_SIZE.y});
+    if (font != nullptr) {
+        char balanceStr[32];
+        snprintf(balanceStr, sizeof(balanceStr), "$: %d", view.balance);
+        textCache.DrawToHeight(queue, LAYER_UI_CONTENT, balanceStr, font, {25, 50}, BOX_SIZE.y);
+    }
+
+    std::vector<uint32_t> unsortedPixels(static_cast<size_t>(TARGET_WIDTH) * TARGET_HEIGHT);
+    std::vector<uint32_t> sortedPixels(unsortedPixels.size());
+
+    const RenderBenchResult unsorted = TimeRenderQueueSubmit(renderer, queue, settings.frames, false);
+    SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA8888, unsortedPixels.data(), TARGET_WIDTH * 4);
+    const RenderBenchResult sorted = TimeRenderQueueSubmit(renderer, queue, settings.frames, true);
+    SDL_RenderReadPixels(renderer, nullptr, SDL_PIXELFORMAT_RGBA8888, sortedPixels.data(), TARGET_WIDTH * 4);
+
+    size_t mismatchedPixels = 0;
+    for (size_t i = 0; i < sortedPixels.size(); i++) {
+        if (sortedPixels[i] != unsortedPixels[i]) {
+            mismatchedPixels++;
+        }
+    }
+
+    std::cout << "Frame at " << game.gameClock / 1000.0 << "s: " << view.enemies.size() << " enemies, "
+              << view.projectiles.size() << " projectiles, " << view.placedEntities.size() << " entities" << std::endl;
+    std::cout << std::left
+              << std::setw(10) << "order" << std::setw(10) << "commands" << std::setw(10) << "sprites"
+              << std::setw(8) << "texts" << std::setw(8) << "rects" << std::setw(10) << "textures"
+              << std::setw(10) << "colors" << std::setw(14) << "pixels" << "ms/frame" << std::endl;
+    PrintRenderBenchRow("recorded", unsorted);
+    PrintRenderBenchRow("sorted", sorted);
+    std::cout << "Pixels differing between orders: " << mismatchedPixels << std::endl;
+
+    textCache.Clear();
+    TTF_CloseFont(font);
+    for (SDL_Texture* texture : {groundTextures.floor, groundTextures.safeZone, groundTextures.wall,
+                                 groundTextures.parkingLotEdge, groundTextures.parkingLot, gameTextures.turret,
+                                 gameTextures.obstacle, gameTextures.projectile, gameTextures.van, gameTextures.pickupTruck}) {
+        SDL_DestroyTexture(texture);
+    }
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(target);
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "SDL.h"
+
+// Draw order, back to front. Order within a layer is not defined, commands there are grouped by texture or color.
+enum RenderLayer : uint8_t {
+    LAYER_GROUND,
+    LAYER_PREVIEW,
+    LAYER_PROJECTILES,
+    LAYER_ENTITIES,
+    LAYER_ENEMIES,
+    LAYER_PARTICLES,
+    LAYER_OVERLAY,
+    LAYER_UI_BACKGROUND,
+    LAYER_UI_BUTTONS,
+    LAYER_UI_CONTENT
+};
+
+struct RenderStats {
+    size_t commands = 0;
+    size_t sprites = 0;
+    size_t texts = 0;
+    size_t rects = 0;
+    size_t geometryBatches = 0;
+    size_t triangles = 0;
+    size_t textureChanges = 0;
+    size_t colorChanges = 0;
+    unsigned long long pixelsFilled = 0;
+
+    size_t StateChanges() const {
+        return textureChanges + colorChanges;
+    }
+};
+
+// Records a frame's draws instead of issuing them, then submits them sorted by layer and render state so
+// consecutive commands share a texture or draw color and SDL can batch them. Nothing is drawn until Submit,
+// so textures referenced by commands (including TextCache entries) must stay alive until then.
+class RenderQueue {
+private:
+    enum CommandKind : uint8_t {
+        COMMAND_SPRITE,
+        COMMAND_TEXT,
+        COMMAND_FILL_RECT,
+        COMMAND_OUTLINE_RECT,
+        COMMAND_GEOMETRY
+    };
+
+    struct Command {
+        RenderLayer layer;
+        CommandKind kind;
+        uint32_t sequence;
+        uint64_t stateKey;  // Texture for sprites and text, packed color for rects
+        SDL_Texture* texture;
+        SDL_Color color;
+        SDL_Rect rect;
+        const SDL_Vertex* vertices;
+        const int* indices;
+        int vertexCount;
+        int indexCount;
+    };
+
+    std::vector<Command> commands;
+    RenderStats stats;
+
+public:
+    explicit RenderQueue(size_t reserveCommands = 2048) {
+        commands.reserve(reserveCommands);
+    }
+
+    void Clear() {
+        commands.clear();
+    }
+
+    void Sprite(RenderLayer layer, SDL_Texture* texture, const SDL_Rect& rect) {
+        Push(layer, COMMAND_SPRITE, reinterpret_cast<uintptr_t>(texture), texture, {}, rect);
+    }
+
+    // Rasterized text, e.g. from TextCache. Drawn like a sprite, counted separately.
+    void Text(RenderLayer layer, SDL_Texture* texture, const SDL_Rect& rect) {
+        Push(layer, COMMAND_TEXT, reinterpret_cast<uintptr_t>(texture), texture, {}, rect);
+    }
+
+    void FillRect(RenderLayer layer, SDL_Color color, const SDL_Rect& rect) {
+        Push(layer, COMMAND_FILL_RECT, PackColor(color), nullptr, color, rect);
+    }
+
+    void OutlineRect(RenderLayer layer, SDL_Color color, const SDL_Rect& rect) {
+        Push(layer, COMMAND_OUTLINE_RECT, PackColor(color), nullptr, color, rect);
+    }
+
+    // A triangle batch drawn with one SDL_RenderGeometry call. Grouped with sprites of the same texture, and like
+    // a texture the vertices and indices must stay alive and unchanged until Submit. The texture may be nullptr.
+    void Geometry(RenderLayer layer, SDL_Texture* texture, const SDL_Vertex* vertices, int vertexCount, const int* indices, int indexCount) {
+        if (indexCount <= 0) {
+            return;
+        }
+
+        Push(layer, COMMAND_GEOMETRY, reinterpret_cast<uintptr_t>(texture), texture, {}, {});
+        Command& command = commands.back();
+        command.vertices = vertices;
+        command.vertexCount = vertexCount;
+        command.indices = indices;
+        command.indexCount = indexCount;
+    }
+
+    // Issues every recorded command to the current render target. Unsorted submission keeps recording order,
+    // which is only useful for measuring what the sort saves. Recorded commands are kept until Clear, so a
+    // frame can be submitted more than once.
+    void Submit(SDL_Renderer* renderer, bool sortByState = true) {
+        if (sortByState) {
+            std::sort(commands.begin(), commands.end(), [](const Command& a, const Command& b) {
+                if (a.layer != b.layer) {
+                    return a.layer < b.layer;
+                }
+                if (IsTextured(a.kind) != IsTextured(b.kind)) {
+                    return IsTextured(a.kind);
+                }
+                if (a.stateKey != b.stateKey) {
+                    return a.stateKey < b.stateKey;
+                }
+                return a.sequence < b.sequence;
+            });
+        } else {
+            std::sort(commands.begin(), commands.end(), [](const Command& a, const Command& b) {
+                return a.sequence < b.sequence;
+            });
+        }
+
+        stats = RenderStats();
+        stats.commands = commands.size();
+
+        const SDL_Texture* currentTexture = nullptr;
+        uint64_t currentColor = 0;
+        bool colorSet = false;
+
+        for (const Command& command : commands) {
+            const auto area = static_cast<unsigned long long>(std::max(command.rect.w, 0)) * static_cast<unsigned long long>(std::max(command.rect.h, 0));
+
+            if (IsTextured(command.kind)) {
+                if (command.texture != currentTexture) {
+                    currentTexture = command.texture;
+                    stats.textureChanges++;
+                }
+
+                if (command.kind == COMMAND_GEOMETRY) {
+                    SDL_RenderGeometry(renderer, command.texture, command.vertices, command.vertexCount, command.indices, command.indexCount);
+                    stats.geometryBatches++;
+                    stats.triangles += static_cast<size_t>(command.indexCount / 3);
+                    continue;
+                }
+
+                SDL_RenderCopy(renderer, command.texture, nullptr, &command.rect);
+                stats.pixelsFilled += area;
+                if (command.kind == COMMAND_TEXT) {
+                    stats.texts++;
+                } else {
+                    stats.sprites++;
+                }
+                continue;
+            }
+
+            if (!colorSet || command.stateKey != currentColor) {
+                SDL_SetRenderDrawColor(renderer, command.color.r, command.color.g, command.color.b, command.color.a);
+                currentColor = command.stateKey;
+                colorSet = true;
+                stats.colorChanges++;
+            }
+
+            if (command.kind == COMMAND_FILL_RECT) {
+                SDL_RenderFillRect(renderer, &command.rect);
+                stats.pixelsFilled += area;
+            } else {
+                SDL_RenderDrawRect(renderer, &command.rect);
+                stats.pixelsFilled += 2 * static_cast<unsigned long long>(std::max(command.rect.w, 0) + std::max(command.rect.h, 0));
+            }
+            stats.rects++;
+        }
+    }
+
+    // From the most recent Submit
+    const RenderStats& Stats() const {
+        return stats;
+    }
+
+private:
+    static bool IsTextured(CommandKind kind) {
+        return kind == COMMAND_SPRITE || kind == COMMAND_TEXT || kind == COMMAND_GEOMETRY;
+    }
+
+    static uint64_t PackColor(SDL_Color color) {
+        return (static_cast<uint64_t>(color.r) << 24) | (static_cast<uint64_t>(color.g) << 16)
+                | (static_cast<uint64_t>(color.b) << 8) | color.a;
+    }
+
+    void Push(RenderLayer layer, CommandKind kind, uint64_t stateKey, SDL_Texture* texture, SDL_Color color, const SDL_Rect& rect) {
+        commands.push_back({layer, kind, static_cast<uint32_t>(commands.size()), stateKey, texture, color, rect, nullptr, nullptr, 0, 0});
+    }
+};
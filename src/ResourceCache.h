@@ -0,0 +1,346 @@
+#pragma once
+
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SDL.h"
+#include "SDL_image.h"
+#include "SDL_mixer.h"
+#include "SDL_ttf.h"
+
+using string = std::string;
+
+enum ResourceKind : uint8_t {
+    RESOURCE_TEXTURE,
+    RESOURCE_FONT,
+    RESOURCE_SOUND
+};
+
+// Textures are counted against video memory, fonts and sounds against system memory
+struct ResourceBudget {
+    size_t textureBytes = 16 << 20;
+    size_t memoryBytes = 8 << 20;
+};
+
+class ResourceCache;
+
+// Keeps one asset of a ResourceCache wanted. The asset is loaded on the first Get and stays resident while any
+// handle to it exists; once the last handle is gone it may be evicted to make room. Handles must not outlive the
+// cache and, like the cache, are only used on the thread that owns the renderer.
+template<typename T>
+class ResourceHandle {
+    friend class ResourceCache;
+
+private:
+    ResourceCache* cache = nullptr;
+    int index = -1;
+
+    ResourceHandle(ResourceCache* cache, int index);
+
+public:
+    ResourceHandle() = default;
+    ResourceHandle(const ResourceHandle& other);
+    ResourceHandle(ResourceHandle&& other) noexcept;
+    ResourceHandle& operator=(ResourceHandle other) noexcept;
+    ~ResourceHandle();
+
+    // Loads the asset if it isn't resident. Returns nullptr if it failed to load.
+    T* Get() const;
+
+    explicit operator bool() const {
+        return cache != nullptr;
+    }
+};
+
+using TextureHandle = ResourceHandle<SDL_Texture>;
+using FontHandle = ResourceHandle<TTF_Font>;
+using SoundHandle = ResourceHandle<Mix_Chunk>;
+
+// Owns every texture, font and sound effect loaded from the asset folder. Assets are registered up front by name,
+// loaded lazily, shared between everyone asking for the same file, and unloaded least recently used first when a
+// load takes their pool over budget. Only assets without handles are ever evicted, so a budget can still be
+// exceeded by what is actually in use; the report says so.
+class ResourceCache {
+    template<typename T> friend class ResourceHandle;
+
+private:
+    struct Entry {
+        string name;
+        ResourceKind kind = RESOURCE_TEXTURE;
+        int pointSize = 0;
+        void* data = nullptr;
+        size_t bytes = 0;
+        int references = 0;
+        int loads = 0;
+        bool failed = false;
+        unsigned long long lastUsed = 0;
+    };
+
+    SDL_Renderer* renderer;
+    string assetFolderPath;
+    ResourceBudget budget;
+    std::vector<Entry> entries;
+    size_t textureBytes = 0;
+    size_t memoryBytes = 0;
+    unsigned long long useClock = 0;
+    unsigned long long loadCount = 0;
+    unsigned long long evictionCount = 0;
+
+public:
+    ResourceCache(SDL_Renderer* renderer, const string& assetFolderPath, const ResourceBudget& budget = ResourceBudget())
+            : renderer(renderer), assetFolderPath(assetFolderPath), budget(budget) {}
+
+    ResourceCache(const ResourceCache&) = delete;
+    ResourceCache& operator=(const ResourceCache&) = delete;
+
+    ~ResourceCache() {
+        Clear();
+    }
+
+    TextureHandle Texture(const string& fileName) {
+        return TextureHandle(this, Register(fileName, RESOURCE_TEXTURE, 0));
+    }
+
+    FontHandle Font(const string& fileName, int pointSize) {
+        return FontHandle(this, Register(fileName, RESOURCE_FONT, pointSize));
+    }
+
+    SoundHandle Sound(const string& fileName) {
+        return SoundHandle(this, Register(fileName, RESOURCE_SOUND, 0));
+    }
+
+    // Unloads everything. Handles stay valid and load again on their next Get.
+    // Must run before the renderer is destroyed and the audio device is closed.
+    void Clear() {
+        for (Entry& entry : entries) {
+            Unload(entry);
+            entry.failed = false;
+        }
+    }
+
+    // Evicts unused assets until both pools are within budget, or nothing unused is left
+    void Trim() {
+        while (textureBytes > budget.textureBytes && EvictLeastRecentlyUsed(true)) {}
+        while (memoryBytes > budget.memoryBytes && EvictLeastRecentlyUsed(false)) {}
+    }
+
+    bool WithinBudget() const {
+        return textureBytes <= budget.textureBytes && memoryBytes <= budget.memoryBytes;
+    }
+
+    size_t TextureBytes() const {
+        return textureBytes;
+    }
+
+    size_t MemoryBytes() const {
+        return memoryBytes;
+    }
+
+    unsigned long long Loads() const {
+        return loadCount;
+    }
+
+    unsigned long long Evictions() const {
+        return evictionCount;
+    }
+
+    void PrintReport(std::ostream& out) const {
+        out << "Resources: video " << std::fixed << std::setprecision(1) << Megabytes(textureBytes) << " / "
+            << Megabytes(budget.textureBytes) << " MB, system " << Megabytes(memoryBytes) << " / "
+            << Megabytes(budget.memoryBytes) << " MB, " << loadCount << " loads, " << evictionCount << " evictions"
+            << (WithinBudget() ? "" : ", OVER BUDGET") << std::endl;
+
+        for (const Entry& entry : entries) {
+            string name = entry.name;
+            if (entry.kind == RESOURCE_FONT) {
+                name += " " + std::to_string(entry.pointSize) + "pt";
+            }
+
+            out << "  " << std::left << std::setw(9) << KindName(entry.kind) << std::setw(28) << name << std::right
+                << std::setw(9) << std::setprecision(1) << static_cast<double>(entry.bytes) / 1024.0 << " KB"
+                << "  refs " << entry.references << "  loads " << entry.loads
+                << (entry.failed ? "  missing" : entry.data != nullptr ? "  resident" : "") << std::endl;
+        }
+    }
+
+private:
+    static double Megabytes(size_t bytes) {
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    }
+
+    static const char* KindName(ResourceKind kind) {
+        switch (kind) {
+            case RESOURCE_TEXTURE:
+                return "texture";
+            case RESOURCE_FONT:
+                return "font";
+            case RESOURCE_SOUND:
+                return "sound";
+        }
+        return "";
+    }
+
+    int Register(const string& fileName, ResourceKind kind, int pointSize) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].kind == kind && entries[i].pointSize == pointSize && entries[i].name == fileName) {
+                return static_cast<int>(i);
+            }
+        }
+
+        Entry entry;
+        entry.name = fileName;
+        entry.kind = kind;
+        entry.pointSize = pointSize;
+        entries.push_back(entry);
+        return static_cast<int>(entries.size() - 1);
+    }
+
+    void* Use(int index) {
+        Entry& entry = entries[index];
+        entry.lastUsed = ++useClock;
+
+        // A missing file is reported once rather than hitting the disk again every frame
+        if (entry.data == nullptr && !entry.failed) {
+            Load(entry);
+        }
+
+        return entry.data;
+    }
+
+    void Load(Entry& entry) {
+        const string path = assetFolderPath + entry.name;
+        entry.loads++;
+        loadCount++;
+
+        switch (entry.kind) {
+            case RESOURCE_TEXTURE: {
+                SDL_Texture* texture = IMG_LoadTexture(renderer, path.c_str());
+                Uint32 format = 0;
+                int w = 0;
+                int h = 0;
+                if (texture != nullptr && SDL_QueryTexture(texture, &format, nullptr, &w, &h) == 0) {
+                    entry.bytes = static_cast<size_t>(w) * static_cast<size_t>(h) * SDL_BYTESPERPIXEL(format);
+                }
+                entry.data = texture;
+                break;
+            }
+            case RESOURCE_FONT: {
+                // FreeType streams glyphs from the file as needed, its size is a fair estimate of what stays in memory
+                SDL_RWops* file = SDL_RWFromFile(path.c_str(), "rb");
+                if (file != nullptr) {
+                    const Sint64 size = SDL_RWsize(file);
+                    entry.bytes = size > 0 ? static_cast<size_t>(size) : 0;
+                    entry.data = TTF_OpenFontRW(file, 1, entry.pointSize);
+                }
+                break;
+            }
+            case RESOURCE_SOUND: {
+                Mix_Chunk* chunk = Mix_LoadWAV(path.c_str());
+                if (chunk != nullptr) {
+                    entry.bytes = sizeof(Mix_Chunk) + chunk->alen;
+                }
+                entry.data = chunk;
+                break;
+            }
+        }
+
+        if (entry.data == nullptr) {
+            entry.failed = true;
+            entry.bytes = 0;
+            SDL_Log("Failed to load %s: %s", path.c_str(), SDL_GetError());
+            return;
+        }
+
+        const bool texture = entry.kind == RESOURCE_TEXTURE;
+        (texture ? textureBytes : memoryBytes) += entry.bytes;
+
+        const size_t limit = texture ? budget.textureBytes : budget.memoryBytes;
+        while ((texture ? textureBytes : memoryBytes) > limit && EvictLeastRecentlyUsed(texture)) {}
+    }
+
+    void Unload(Entry& entry) {
+        if (entry.data == nullptr) {
+            return;
+        }
+
+        switch (entry.kind) {
+            case RESOURCE_TEXTURE:
+                SDL_DestroyTexture(static_cast<SDL_Texture*>(entry.data));
+                textureBytes -= entry.bytes;
+                break;
+            case RESOURCE_FONT:
+                TTF_CloseFont(static_cast<TTF_Font*>(entry.data));
+                memoryBytes -= entry.bytes;
+                break;
+            case RESOURCE_SOUND:
+                // Stops any channel still playing it
+                Mix_FreeChunk(static_cast<Mix_Chunk*>(entry.data));
+                memoryBytes -= entry.bytes;
+                break;
+        }
+
+        entry.data = nullptr;
+        entry.bytes = 0;
+    }
+
+    bool EvictLeastRecentlyUsed(bool texturePool) {
+        Entry* leastRecentlyUsed = nullptr;
+        for (Entry& entry : entries) {
+            if (entry.data == nullptr || entry.references > 0 || (entry.kind == RESOURCE_TEXTURE) != texturePool) {
+                continue;
+            }
+
+            if (leastRecentlyUsed == nullptr || entry.lastUsed < leastRecentlyUsed->lastUsed) {
+                leastRecentlyUsed = &entry;
+            }
+        }
+
+        if (leastRecentlyUsed == nullptr) {
+            return false;
+        }
+
+        Unload(*leastRecentlyUsed);
+        evictionCount++;
+        return true;
+    }
+};
+
+template<typename T>
+ResourceHandle<T>::ResourceHandle(ResourceCache* cache, int index) : cache(cache), index(index) {
+    cache->entries[index].references++;
+}
+
+template<typename T>
+ResourceHandle<T>::ResourceHandle(const ResourceHandle& other) : cache(other.cache), index(other.index) {
+    if (cache != nullptr) {
+        cache->entries[index].references++;
+    }
+}
+
+template<typename T>
+ResourceHandle<T>::ResourceHandle(ResourceHandle&& other) noexcept : cache(other.cache), index(other.index) {
+    other.cache = nullptr;
+    other.index = -1;
+}
+
+template<typename T>
+ResourceHandle<T>& ResourceHandle<T>::operator=(ResourceHandle other) noexcept {
+    std::swap(cache, other.cache);
+    std::swap(index, other.index);
+    return *this;
+}
+
+template<typename T>
+ResourceHandle<T>::~ResourceHandle() {
+    if (cache != nullptr) {
+        cache->entries[index].references--;
+    }
+}
+
+template<typename T>
+T* ResourceHandle<T>::Get() const {
+    return cache != nullptr ? static_cast<T*>(cache->Use(index)) : nullptr;
+}
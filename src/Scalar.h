@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Fixed.h"
+
+// Number type for simulation positions, sizes and speeds. Configure with -DLD54_FIXED_POINT=ON for bit-identical
+// results across builds (replays, parallel balance runs); the default stays in double. Time stays double in both:
+// the clock, turret timers and spawn times only use + - * / and PortableExp, which round the same everywhere with
+// FMA contraction off (see CMakeLists.txt).
+#ifdef LD54_FIXED_POINT
+using Scalar = Fixed16_16;
+#else
+using Scalar = double;
+#endif
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Game.h"
+#include "GameServer.h"
+#include "Snapshot.h"
+#include "Socket.h"
+
+struct ServerBenchSettings {
+    ServerSettings server;
+    int botThreads = 2;
+    double seconds = 10.0;
+    double actionIntervalMs = 250.0;
+    bool endless = false;
+    unsigned int seed = 1;
+};
+
+inline uint64_t ServerClockUs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline std::unique_ptr<Game> MakeServerGame(const ServerBenchSettings& settings, const std::shared_ptr<const WaveSchedule>& waves, int session) {
+    std::unique_ptr<EnemySpawner> spawner;
+    if (settings.endless) {
+        spawner = std::make_unique<EndlessSpawner>(settings.seed + static_cast<unsigned int>(session));
+    } else {
+        spawner = std::make_unique<ScriptedSpawner>(waves);
+    }
+    return std::make_unique<Game>(GameConfig(), GameTextures(), std::move(spawner));
+}
+
+// Scripted stand-in for a player: joins one session, places something at random every so often, and rebuilds
+// the full game state from every snapshot it receives to check the deltas decode.
+class BotClient {
+private:
+    static constexpr int HISTORY = 32;
+
+    UdpSocket socket;
+    SocketAddress server;
+    uint32_t nonce;
+    uint32_t sessionId = UINT32_MAX;
+    uint64_t nextJoinUs = 0;
+    uint64_t nextActionUs = 0;
+    double actionIntervalMs;
+    std::mt19937 rng;
+
+    std::unique_ptr<Game> mirror;
+    std::vector<uint8_t> states[HISTORY];
+    int64_t stateTicks[HISTORY];
+    int64_t latestTick = -1;
+    uint32_t nextInputSequence = 1;
+    uint32_t lastMeasuredSequence = 0;
+
+    std::vector<uint8_t> packet;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> outgoing;
+
+public:
+    unsigned long long snapshotsReceived = 0;
+    unsigned long long decodeFailures = 0;
+    std::vector<double> inputLatenciesMs;
+
+    BotClient(const SocketAddress& server, uint32_t nonce, double actionIntervalMs, std::unique_ptr<Game> mirror)
+            : server(server), nonce(nonce), actionIntervalMs(actionIntervalMs), rng(nonce), mirror(std::move(mirror)),
+              packet(GameServer::MAX_PACKET_BYTES) {
+        for (int i = 0; i < HISTORY; i++) {
+            stateTicks[i] = -1;
+        }
+        inputLatenciesMs.reserve(4096);
+    }
+
+    bool Open() {
+        return socket.Bind(SocketAddress::Loopback(0));
+    }
+
+    bool Joined() const {
+        return sessionId != UINT32_MAX;
+    }
+
+    void Poll(uint64_t nowUs) {
+        SocketAddress from;
+        int size;
+        while ((size = socket.ReceiveFrom(packet.data(), packet.size(), from, 0)) > 0) {
+            Handle(static_cast<size_t>(size), nowUs);
+        }
+
+        if (!Joined()) {
+            if (nowUs >= nextJoinUs) {
+                SnapshotWriter writer(outgoing);
+                writer.Write(static_cast<uint8_t>(PACKET_JOIN));
+                writer.Write(nonce);
+                socket.SendTo(server, outgoing.data(), outgoing.size());
+                nextJoinUs = nowUs + 100000;
+            }
+            return;
+        }
+
+        if (nowUs >= nextActionUs) {
+            std::uniform_int_distribution<int> column(4, GRID_WIDTH - 4);
+            std::uniform_int_distribution<int> row(0, GRID_HEIGHT - 1);
+
+            ClientInput input;
+            input.hasCommand = 1;
+            input.command.type = COMMAND_PLACE_ENTITY;
+            input.command.cellX = column(rng);
+            input.command.cellY = row(rng);
+            input.command.entityType = rng() % 2 == 0 ? TURRET : OBSTACLE;
+            SendInput(input, nowUs);
+
+            nextActionUs = nowUs + static_cast<uint64_t>(actionIntervalMs * 1000.0);
+        }
+    }
+
+private:
+    void SendInput(ClientInput& input, uint64_t nowUs) {
+        if (input.hasCommand != 0) {
+            input.sequence = nextInputSequence++;
+        }
+        input.ackTick = latestTick;
+        input.clientTimeUs = nowUs;
+
+        SnapshotWriter writer(outgoing);
+        writer.Write(static_cast<uint8_t>(PACKET_INPUT));
+        writer.Write(sessionId);
+        writer.Write(input);
+        socket.SendTo(server, outgoing.data(), outgoing.size());
+    }
+
+    void Handle(size_t size, uint64_t nowUs) {
+        SnapshotReader reader(packet.data(), size);
+        uint8_t type = 0;
+        reader.Read(type);
+
+        if (type == PACKET_JOINED) {
+            uint32_t replyNonce = 0;
+            uint32_t session = 0;
+            if (reader.Read(replyNonce) && reader.Read(session) && replyNonce == nonce) {
+                sessionId = session;
+            }
+            return;
+        }
+
+        if (type != PACKET_SNAPSHOT) {
+            return;
+        }
+
+        uint32_t session = 0;
+        int64_t tick = 0;
+        int64_t baseTick = 0;
+        uint32_t lastInputSequence = 0;
+        uint64_t lastInputClientTimeUs = 0;
+        uint32_t payloadSize = 0;
+        reader.Read(session);
+        reader.Read(tick);
+        reader.Read(baseTick);
+        reader.Read(lastInputSequence);
+        reader.Read(lastInputClientTimeUs);
+        reader.Read(payloadSize);
+        if (!reader.ReadBytes(payload, payloadSize) || session != sessionId || tick <= latestTick) {
+            return;
+        }
+
+        snapshotsReceived++;
+
+        std::vector<uint8_t>& state = states[tick % HISTORY];
+        bool decoded;
+        if (baseTick < 0) {
+            state.swap(payload);
+            decoded = true;
+        } else {
+            const int baseSlot = static_cast<int>(baseTick % HISTORY);
+            decoded = stateTicks[baseSlot] == baseTick;
+            if (decoded) {
+                if (&states[baseSlot] != &state) {
+                    state = states[baseSlot];
+                }
+                decoded = ApplySnapshotDelta(state, payload);
+            }
+        }
+
+        if (!decoded || !mirror->LoadState(state)) {
+            decodeFailures++;
+            return;
+        }
+
+        stateTicks[tick % HISTORY] = tick;
+        latestTick = tick;
+
+        if (lastInputSequence > lastMeasuredSequence) {
+            lastMeasuredSequence = lastInputSequence;
+            inputLatenciesMs.push_back(static_cast<double>(nowUs - lastInputClientTimeUs) / 1000.0);
+        }
+
+        // Acknowledge right away so the next snapshot can be a delta against this one
+        ClientInput ack;
+        SendInput(ack, nowUs);
+    }
+};
+
+inline void PrintServerUsage() {
+    std::cout << "Usage: LD54 --server [options]        serve sessions on localhost until Enter is pressed\n"
+                 "       LD54 --server-bench [options]  serve and drive every session with a local bot client\n"
+                 "  --sessions N         game worlds to host (default 64)\n"
+                 "  --threads N          simulation worker threads (default: all cores)\n"
+                 "  --port N             UDP port (default 27054, bench default: any free port)\n"
+                 "  --snapshot-ticks N   simulation ticks between snapshots (default 3)\n"
+                 "  --idle-ms X          free a session after this long without input (default 10000)\n"
+                 "  --endless            procedural endless waves, session i uses seed + i\n"
+                 "  --seed N             endless base seed (default 1)\n"
+                 "  --seconds X          bench duration (default 10)\n"
+                 "  --bot-threads N      bench client threads (default 2)\n"
+                 "  --action-ms X        bench time between bot placements (default 250)" << std::endl;
+}
+
+inline bool ParseServerOptions(int argc, char* argv[], ServerBenchSettings& settings) {
+    try {
+        for (int i = 2; i < argc; i++) {
+            const string option = argv[i];
+            if (option == "--endless") {
+                settings.endless = true;
+                continue;
+            }
+
+            if (i + 1 >= argc) {
+                throw std::invalid_argument(option);
+            }
+            const string value = argv[++i];
+
+            if (option == "--sessions") {
+                settings.server.sessions = std::stoi(value);
+            } else if (option == "--threads") {
+                settings.server.threads = std::stoi(value);
+            } else if (option == "--port") {
+                settings.server.port = static_cast<uint16_t>(std::stoi(value));
+            } else if (option == "--snapshot-ticks") {
+                settings.server.snapshotInterval = std::stoi(value);
+            } else if (option == "--idle-ms") {
+                settings.server.idleTimeoutMs = std::stod(value);
+            } else if (option == "--seed") {
+                settings.seed = static_cast<unsigned int>(std::stoul(value));
+            } else if (option == "--seconds") {
+                settings.seconds = std::stod(value);
+            } else if (option == "--bot-threads") {
+                settings.botThreads = std::stoi(value);
+            } else if (option == "--action-ms") {
+                settings.actionIntervalMs = std::stod(value);
+            } else {
+                throw std::invalid_argument(option);
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    return settings.server.sessions > 0 && settings.server.snapshotInterval > 0 && settings.server.idleTimeoutMs > 0.0
+           && settings.botThreads > 0 && settings.seconds > 0.0;
+}
+
+inline void PrintServerStats(const GameServer& server, double seconds) {
+    const ServerStats stats = server.Stats();
+    const double usPerSessionTick = stats.sessionTicks > 0 ? static_cast<double>(stats.busyNs) / 1000.0 / static_cast<double>(stats.sessionTicks) : 0.0;
+
+    std::cout << "Sessions: " << server.ConnectedSessions() << " on " << server.Threads() << " threads" << std::endl;
+    std::cout << std::fixed << std::setprecision(1)
+              << "Session ticks/s: " << static_cast<double>(stats.sessionTicks) / seconds
+              << ", " << std::setprecision(2) << usPerSessionTick << "us per session tick incl. snapshots"
+              << ", late ticks: " << stats.lateTicks << std::endl;
+    if (usPerSessionTick > 0.0) {
+        std::cout << std::setprecision(0) << "Sessions per core at 60Hz: ~" << Simulation::STEP_MS * 1000.0 / usPerSessionTick << std::endl;
+    }
+    if (stats.snapshotsSent > 0) {
+        std::cout << "Snapshots sent: " << stats.snapshotsSent << " (" << stats.fullSnapshotsSent << " full), "
+                  << stats.snapshotBytes / stats.snapshotsSent << " bytes average" << std::endl;
+    }
+    if (stats.sessionsTimedOut > 0) {
+        std::cout << "Sessions timed out: " << stats.sessionsTimedOut << std::endl;
+    }
+}
+
+inline int RunServerCommand(int argc, char* argv[], const string& wavesPath) {
+    ServerBenchSettings settings;
+    if (!ParseServerOptions(argc, argv, settings)) {
+        PrintServerUsage();
+        return 1;
+    }
+
+    SocketLibrary socketLibrary;
+    string error;
+    const auto waves = settings.endless ? std::make_shared<const WaveSchedule>() : LoadWaveSchedule(wavesPath, error);
+    if (waves == nullptr) {
+        std::cout << "Could not load waves from " << error << std::endl;
+        return 1;
+    }
+    GameServer server(settings.server, [&](int session) { return MakeServerGame(settings, waves, session); });
+    if (!server.Start()) {
+        std::cout << "Could not bind UDP port " << settings.server.port << std::endl;
+        return 1;
+    }
+
+    std::cout << "Serving " << settings.server.sessions << " sessions on 127.0.0.1:" << server.Port() << ", press Enter to stop" << std::endl;
+    const auto start = std::chrono::steady_clock::now();
+    std::cin.get();
+    server.Stop();
+
+    PrintServerStats(server, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
+
+// Everything over real loopback sockets in one process: the server on its worker pool, one bot client per session
+// spread over a few client threads.
+inline int RunServerBenchCommand(int argc, char* argv[], const string& wavesPath) {
+    ServerBenchSettings settings;
+    settings.server.port = 0;
+    if (!ParseServerOptions(argc, argv, settings)) {
+        PrintServerUsage();
+        return 1;
+    }
+
+    SocketLibrary socketLibrary;
+    string error;
+    const auto waves = settings.endless ? std::make_shared<const WaveSchedule>() : LoadWaveSchedule(wavesPath, error);
+    if (waves == nullptr) {
+        std::cout << "Could not load waves from " << error << std::endl;
+        return 1;
+    }
+    GameServer server(settings.server, [&](int session) { return MakeServerGame(settings, waves, session); });
+    if (!server.Start()) {
+        std::cout << "Could not bind UDP port " << settings.server.port << std::endl;
+        return 1;
+    }
+
+    // Mirrors only need to decode, their spawner never runs; session ids are handed out in join order
+    std::vector<std::unique_ptr<BotClient>> bots;
+    const SocketAddress serverAddress = SocketAddress::Loopback(server.Port());
+    for (int i = 0; i < settings.server.sessions; i++) {
+        bots.push_back(std::make_unique<BotClient>(serverAddress, static_cast<uint32_t>(i + 1), settings.actionIntervalMs, MakeServerGame(settings, waves, 0)));
+        if (!bots.back()->Open()) {
+            std::cout << "Could not open a client socket" << std::endl;
+            return 1;
+        }
+    }
+
+    std::atomic<bool> running {true};
+    std::vector<std::thread> botThreads;
+    for (int t = 0; t < settings.botThreads; t++) {
+        botThreads.emplace_back([&, t] {
+            while (running) {
+                const uint64_t nowUs = ServerClockUs();
+                for (size_t i = static_cast<size_t>(t); i < bots.size(); i += static_cast<size_t>(settings.botThreads)) {
+                    bots[i]->Poll(nowUs);
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        });
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(settings.seconds));
+    running = false;
+    for (std::thread& thread : botThreads) {
+        thread.join();
+    }
+    server.Stop();
+    const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned long long received = 0;
+    unsigned long long failures = 0;
+    int joined = 0;
+    std::vector<double> latencies;
+    for (const auto& bot : bots) {
+        received += bot->snapshotsReceived;
+        failures += bot->decodeFailures;
+        joined += bot->Joined() ? 1 : 0;
+        latencies.insert(latencies.end(), bot->inputLatenciesMs.begin(), bot->inputLatenciesMs.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * static_cast<double>(latencies.size() - 1))];
+    };
+
+    PrintServerStats(server, elapsedSeconds);
+    std::cout << "Clients joined: " << joined << "/" << bots.size() << ", snapshots received: " << received
+              << ", failed to decode: " << failures << std::endl;
+    std::cout << std::setprecision(2) << "Input to snapshot latency ms p50/p90/p99/max: " << percentile(0.5) << " / "
+              << percentile(0.9) << " / " << percentile(0.99) << " / " << (latencies.empty() ? 0.0 : latencies.back())
+              << " (" << latencies.size() << " inputs)" << std::endl;
+
+    return 0;
+}
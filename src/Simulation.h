@@ -0,0 +1,429 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SDL.h"
+#include "AllocationCounter.h"
+#include "FrameTimer.h"
+#include "Game.h"
+#include "Logger.h"
+#include "RingQueue.h"
+#include "Snapshot.h"
+#include "TripleBuffer.h"
+
+// Running totals of every event the game has published, so a reader that skips snapshots still sees that
+// something happened since the last one it looked at
+struct GameEventCounts {
+    uint64_t enemiesSpawned = 0;
+    uint64_t turretsFired = 0;
+    uint64_t enemiesHit = 0;
+    uint64_t wallBreaches = 0;
+    uint64_t entitiesPlaced = 0;
+    uint64_t entitiesSold = 0;
+};
+
+enum EffectType : uint8_t {
+    EFFECT_IMPACT,      // Projectile hit an enemy
+    EFFECT_EXPLOSION,   // Enemy ran into a placed entity
+    EFFECT_BREACH       // Enemy reached the wall
+};
+
+// Where something worth a visual effect happened, centred on the enemy involved
+struct EffectEvent {
+    EffectType type;
+    float x;
+    float y;
+};
+
+// Everything the render thread needs to draw one frame, copied out of the Game after a simulation step.
+// Vectors are reserved to the Game's own limits, so refilling a snapshot doesn't allocate.
+struct RenderSnapshot {
+    GroundType ground[GRID_WIDTH][GRID_HEIGHT] {};
+    EntityType entityTypes[GRID_WIDTH][GRID_HEIGHT] {};
+    std::vector<Entity> placedEntities;
+    std::vector<Entity> projectiles;
+    std::vector<Enemy> enemies;
+    GameEventCounts eventCounts;
+    int balance = 0;
+    long long tick = 0;
+    bool gameOver = false;
+    bool victorious = false;
+
+    // Requested game speed, and what the simulation actually managed over the last second
+    int timeScale = 1;
+    double achievedTimeScale = 1.0;
+    bool fallingBehind = false;
+
+    RenderSnapshot() {
+        placedEntities.reserve(GRID_WIDTH * GRID_HEIGHT);
+        projectiles.reserve(GRID_WIDTH * GRID_HEIGHT);
+        enemies.reserve(256);
+    }
+};
+
+inline void FillRenderSnapshot(const Game& game, const GameEventCounts& eventCounts, RenderSnapshot& snapshot) {
+    snapshot.placedEntities.clear();
+
+    for (int i = 0; i < GRID_WIDTH; i++) {
+        for (int j = 0; j < GRID_HEIGHT; j++) {
+            const Cell& cell = game.map[i][j];
+            snapshot.ground[i][j] = cell.ground;
+            snapshot.entityTypes[i][j] = cell.entityType;
+
+            if (cell.entityType != NO_ENTITY) {
+                snapshot.placedEntities.push_back(*cell.entity);
+            }
+        }
+    }
+
+    snapshot.projectiles.assign(game.projectiles.begin(), game.projectiles.end());
+    snapshot.enemies.assign(game.enemies.begin(), game.enemies.end());
+    snapshot.eventCounts = eventCounts;
+    snapshot.balance = game.balance;
+    snapshot.tick = game.tick;
+    snapshot.gameOver = game.gameOver;
+    snapshot.victorious = game.victorious;
+}
+
+enum SimulationCommandType {
+    COMMAND_PLACE_ENTITY,
+    COMMAND_SELL_ENTITY,
+    COMMAND_SET_ACTIVE,
+    COMMAND_SET_REWINDING,
+    COMMAND_SAVE,
+    COMMAND_LOAD,
+    COMMAND_SET_TIME_SCALE
+};
+
+struct SimulationCommand {
+    SimulationCommandType type = COMMAND_SET_ACTIVE;
+    int cellX = 0;
+    int cellY = 0;
+    EntityType entityType = NO_ENTITY;
+    bool enabled = false;
+    int timeScale = 1;
+};
+
+// Owns the Game and steps it at a fixed rate on its own thread. The render thread talks to it only through
+// Post, and reads back the latest RenderSnapshot, so a slow present or text upload never holds up the game
+// clock and a long simulation step never holds up a frame.
+class Simulation {
+public:
+    static constexpr double STEP_MS = 1000.0 / 60.0;
+    static constexpr int MAX_TIME_SCALE = 16;
+
+private:
+    // Wall time one wake-up may spend stepping before it publishes what it has. Half a display frame keeps
+    // snapshots coming every frame and leaves the render thread a core's worth of time even on a single core.
+    static constexpr double WAKE_BUDGET_MS = STEP_MS * 0.5;
+    static constexpr double REPORT_INTERVAL_MS = 1000.0;
+    static constexpr int ALLOCATION_WARMUP_STEPS = 10;
+
+    // Ten seconds of rewind. Slots are sized up front so recording every step stays allocation free.
+    static constexpr size_t REWIND_SNAPSHOTS = 600;
+    static constexpr size_t SNAPSHOT_RESERVE_BYTES = 8 * 1024;
+
+    Game game;
+    Logger& logger;
+    string quickSavePath;
+    RingQueue<SimulationCommand, 64> commands;
+    RingQueue<EffectEvent, 4096> effects;
+    TripleBuffer<RenderSnapshot> renderSnapshots;
+    TripleBuffer<std::vector<uint8_t>> forkStates;
+    bool forkStateGrew = false;
+    GameEventCounts eventCounts;
+
+    SnapshotRing<REWIND_SNAPSHOTS> rewindRing {SNAPSHOT_RESERVE_BYTES};
+    std::vector<uint8_t> snapshotBuffer;
+    size_t rewindAge = 0;
+    bool rewinding = false;
+    bool active = false;
+
+    // Game time runs timeScale fixed steps per real step. When a wake-up runs out of budget the backlog is dropped,
+    // so the game slows down instead of spiralling, and the shortfall is reported through the render snapshot.
+    int timeScale = 1;
+    double stepCostMs = 0.0;
+    double reportWallMs = 0.0;
+    double reportGameMs = 0.0;
+    double achievedTimeScale = 1.0;
+    bool fellBehindThisReport = false;
+    bool fallingBehind = false;
+
+    std::atomic<bool> running {true};
+    std::thread thread;
+
+public:
+    Simulation(const GameConfig& config, const GameTextures& textures, std::unique_ptr<EnemySpawner> spawner,
+               Logger& logger, string quickSavePath)
+            : game(config, textures, std::move(spawner)), logger(logger), quickSavePath(std::move(quickSavePath)) {
+        snapshotBuffer.reserve(SNAPSHOT_RESERVE_BYTES);
+        PublishRenderSnapshot();
+        PublishForkState();
+        thread = std::thread([this] { Run(); });
+    }
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    ~Simulation() {
+        running = false;
+        thread.join();
+    }
+
+    // Render thread. Returns false if the queue is full and the command was dropped.
+    bool Post(const SimulationCommand& command) {
+        return commands.Push(command);
+    }
+
+    // Render thread. Effects are dropped, not queued, if the render thread falls this far behind.
+    bool PopEffect(EffectEvent& effect) {
+        return effects.Pop(effect);
+    }
+
+    // Render thread. Picks up the newest snapshot if there is one; the returned reference stays valid and
+    // unchanged until the next call.
+    const RenderSnapshot& LatestRenderSnapshot() {
+        renderSnapshots.Consume();
+        return renderSnapshots.ReadSlot();
+    }
+
+    // One other thread, e.g. a PlacementPreview. The newest full game state, as saved by Game::SaveState, to load
+    // into a Game of its own. Returns false, keeping the current state, if nothing new has been published.
+    bool ConsumeForkState() {
+        return forkStates.Consume();
+    }
+
+    const std::vector<uint8_t>& ForkState() const {
+        return forkStates.ReadSlot();
+    }
+
+private:
+    void Run() {
+        FrameTimer timer;
+        timer.Update();
+        double accumulatorMs = 0.0;
+        long long stepCount = 0;
+        const double msPerCount = 1000.0 / static_cast<double>(SDL_GetPerformanceFrequency());
+
+        while (running) {
+            const size_t allocationsAtWakeStart = AllocationCounter::ThreadCount();
+            const size_t rewindBytesBefore = rewindRing.ReservedBytes() + snapshotBuffer.capacity();
+            forkStateGrew = false;
+            const Uint64 wakeStart = SDL_GetPerformanceCounter();
+
+            timer.Update();
+            const bool commandsApplied = ApplyCommands();
+            if (active || rewinding) {
+                accumulatorMs += timer.frameDeltaMs * timeScale;
+            }
+
+            // Always at least one step, then only as many as the estimated cost says still fit in the budget
+            int steps = 0;
+            while (accumulatorMs >= STEP_MS) {
+                const double elapsedMs = static_cast<double>(SDL_GetPerformanceCounter() - wakeStart) * msPerCount;
+                if (steps > 0 && elapsedMs + stepCostMs > WAKE_BUDGET_MS) {
+                    break;
+                }
+
+                const Uint64 stepStart = SDL_GetPerformanceCounter();
+                Step();
+                const double costMs = static_cast<double>(SDL_GetPerformanceCounter() - stepStart) * msPerCount;
+                stepCostMs = stepCostMs == 0.0 ? costMs : stepCostMs + (costMs - stepCostMs) * 0.1;
+
+                accumulatorMs -= STEP_MS;
+                steps++;
+            }
+
+            if (accumulatorMs >= STEP_MS) {
+                accumulatorMs = 0.0;
+                fellBehindThisReport = true;
+            }
+
+            UpdateTimeScaleReport(timer.frameDeltaMs, steps);
+
+            if (steps > 0 || commandsApplied) {
+                PublishRenderSnapshot();
+                PublishForkState();
+            } else {
+                SDL_Delay(1);
+            }
+
+            // Commands may place entities or touch the disk, rewinding brings sold entities back, and the rewind
+            // ring and fork states grow until they have seen the biggest snapshot of the session. Anything else
+            // allocating is a regression.
+            stepCount += steps;
+            const bool mayAllocate = stepCount <= ALLOCATION_WARMUP_STEPS || commandsApplied || rewinding
+                    || rewindRing.ReservedBytes() + snapshotBuffer.capacity() != rewindBytesBefore || forkStateGrew;
+            SDL_assert(mayAllocate || AllocationCounter::ThreadCount() == allocationsAtWakeStart);
+        }
+    }
+
+    // Only counts time the game was meant to be running, so pausing doesn't read as falling behind
+    void UpdateTimeScaleReport(double wallMs, int steps) {
+        if (!active || rewinding || game.gameOver) {
+            reportWallMs = 0.0;
+            reportGameMs = 0.0;
+            fellBehindThisReport = false;
+            achievedTimeScale = timeScale;
+            fallingBehind = false;
+            return;
+        }
+
+        reportWallMs += wallMs;
+        reportGameMs += steps * STEP_MS;
+        if (reportWallMs < REPORT_INTERVAL_MS) {
+            return;
+        }
+
+        achievedTimeScale = reportGameMs / reportWallMs;
+        if (fellBehindThisReport && !fallingBehind) {
+            logger.Log<LOG_WARNING>("Simulation falling behind requested time scale", {game.tick});
+        }
+        fallingBehind = fellBehindThisReport;
+
+        reportWallMs = 0.0;
+        reportGameMs = 0.0;
+        fellBehindThisReport = false;
+    }
+
+    bool ApplyCommands() {
+        bool applied = false;
+        SimulationCommand command;
+
+        while (commands.Pop(command)) {
+            applied = true;
+
+            switch (command.type) {
+                case COMMAND_PLACE_ENTITY:
+                    game.PlaceEntity(command.cellX, command.cellY, command.entityType);
+                    break;
+                case COMMAND_SELL_ENTITY:
+                    game.SellEntity(command.cellX, command.cellY);
+                    break;
+                case COMMAND_SET_ACTIVE:
+                    active = command.enabled;
+                    break;
+                case COMMAND_SET_REWINDING:
+                    rewinding = command.enabled;
+                    if (!rewinding && rewindAge > 0) {
+                        rewindRing.Truncate(rewindAge);
+                        rewindAge = 0;
+                    }
+                    break;
+                case COMMAND_SAVE:
+                    SaveToFile();
+                    break;
+                case COMMAND_LOAD:
+                    LoadFromFile();
+                    break;
+                case COMMAND_SET_TIME_SCALE:
+                    timeScale = std::clamp(command.timeScale, 1, MAX_TIME_SCALE);
+                    achievedTimeScale = timeScale;
+                    reportWallMs = 0.0;
+                    reportGameMs = 0.0;
+                    fellBehindThisReport = false;
+                    break;
+            }
+        }
+
+        ConsumeEvents();
+        return applied;
+    }
+
+    // Rewinding steps back one recorded tick per step, so it plays back at the speed it was recorded
+    void Step() {
+        if (rewinding) {
+            if (rewindAge + 1 < rewindRing.Size() && rewindRing.Get(rewindAge + 1, snapshotBuffer) && game.LoadState(snapshotBuffer)) {
+                rewindAge++;
+                game.events.Clear();
+            }
+            return;
+        }
+
+        if (!active || game.gameOver) {
+            return;
+        }
+
+        game.Update(STEP_MS);
+        ConsumeEvents();
+
+        game.SaveState(snapshotBuffer);
+        rewindRing.Push(snapshotBuffer);
+    }
+
+    void SaveToFile() {
+        game.SaveState(snapshotBuffer);
+        if (!quickSavePath.empty() && SaveSnapshotToFile(quickSavePath, snapshotBuffer)) {
+            logger.Log<LOG_INFO>("Saved snapshot", {game.tick});
+        } else {
+            logger.Log<LOG_ERROR>("Could not save snapshot");
+        }
+    }
+
+    void LoadFromFile() {
+        if (!quickSavePath.empty() && LoadSnapshotFromFile(quickSavePath, snapshotBuffer) && game.LoadState(snapshotBuffer)) {
+            game.events.Clear();
+            rewindRing.Clear();
+            rewindAge = 0;
+            logger.Log<LOG_INFO>("Loaded snapshot", {game.tick});
+        } else {
+            logger.Log<LOG_ERROR>("Could not load snapshot");
+        }
+    }
+
+    void ConsumeEvents() {
+        const GameEventBus& events = game.events;
+        const long long tick = game.tick;
+
+        const Vec2 enemySize = Game::EnemySize();
+        const auto centreX = [&](const Vec2& pos) { return static_cast<float>(pos.x + enemySize.x / 2); };
+        const auto centreY = [&](const Vec2& pos) { return static_cast<float>(pos.y + enemySize.y / 2); };
+
+        for (const WallBreachEvent& breach : events.Get<WallBreachEvent>()) {
+            logger.Log<LOG_INFO>("Enemy hit wall", {tick, breach.enemyId, static_cast<double>(breach.pos.x), static_cast<double>(breach.pos.y)});
+            effects.Push({EFFECT_BREACH, centreX(breach.pos), centreY(breach.pos)});
+        }
+
+        for (const EnemyHitEvent& hit : events.Get<EnemyHitEvent>()) {
+            if (hit.cellX < 0) {
+                logger.Log<LOG_INFO>("Projectile hit enemy", {tick, hit.enemyId, static_cast<double>(hit.pos.x), static_cast<double>(hit.pos.y)});
+                effects.Push({EFFECT_IMPACT, centreX(hit.pos), centreY(hit.pos)});
+            } else {
+                logger.Log<LOG_INFO>("Entity hit enemy", {tick, hit.enemyId, static_cast<double>(hit.pos.x), static_cast<double>(hit.pos.y)});
+                effects.Push({EFFECT_EXPLOSION, centreX(hit.pos), centreY(hit.pos)});
+            }
+        }
+
+        eventCounts.enemiesSpawned += events.Get<EnemySpawnedEvent>().size();
+        eventCounts.turretsFired += events.Get<TurretFiredEvent>().size();
+        eventCounts.enemiesHit += events.Get<EnemyHitEvent>().size();
+        eventCounts.wallBreaches += events.Get<WallBreachEvent>().size();
+        eventCounts.entitiesPlaced += events.Get<EntityPlacedEvent>().size();
+        eventCounts.entitiesSold += events.Get<EntitySoldEvent>().size();
+
+        game.events.Clear();
+    }
+
+    void PublishRenderSnapshot() {
+        RenderSnapshot& snapshot = renderSnapshots.WriteSlot();
+        FillRenderSnapshot(game, eventCounts, snapshot);
+        snapshot.timeScale = timeScale;
+        snapshot.achievedTimeScale = achievedTimeScale;
+        snapshot.fallingBehind = fallingBehind;
+        renderSnapshots.Publish();
+    }
+
+    // Like the rewind ring, each slot grows until it has held the biggest state of the session
+    void PublishForkState() {
+        std::vector<uint8_t>& state = forkStates.WriteSlot();
+        const size_t capacityBefore = state.capacity();
+        game.SaveState(state);
+        forkStateGrew = forkStateGrew || state.capacity() != capacityBefore;
+        forkStates.Publish();
+    }
+};
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Raw little-endian-as-in-memory binary state. Snapshots are only meant to be read back by the same build,
+// which is what rewinding and desync debugging need, so there is no per-field schema.
+class SnapshotWriter {
+private:
+    std::vector<uint8_t>& buffer;
+
+public:
+    explicit SnapshotWriter(std::vector<uint8_t>& buffer) : buffer(buffer) {
+        buffer.clear();
+    }
+
+    template<typename T>
+    void Write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written");
+        const size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    void WriteBytes(const void* data, size_t size) {
+        const size_t offset = buffer.size();
+        buffer.resize(offset + size);
+        memcpy(buffer.data() + offset, data, size);
+    }
+};
+
+class SnapshotReader {
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t offset = 0;
+    bool failed = false;
+
+public:
+    SnapshotReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    explicit SnapshotReader(const std::vector<uint8_t>& buffer) : data(buffer.data()), size(buffer.size()) {}
+
+    // Reads past the end leave value untouched and make Failed() true
+    template<typename T>
+    bool Read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read");
+        if (failed || size - offset < sizeof(T)) {
+            failed = true;
+            return false;
+        }
+
+        memcpy(&value, data + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    // Replaces out with the next size bytes
+    bool ReadBytes(std::vector<uint8_t>& out, size_t size) {
+        if (failed || this->size - offset < size) {
+            failed = true;
+            return false;
+        }
+
+        out.assign(data + offset, data + offset + size);
+        offset += size;
+        return true;
+    }
+
+    bool Failed() const {
+        return failed;
+    }
+
+    bool AtEnd() const {
+        return offset == size;
+    }
+};
+
+// Delta format: u32 full size, then runs of [u16 unchanged bytes][u16 changed bytes][changed bytes XOR base].
+// Consecutive ticks mostly differ in a handful of positions, so deltas are a small fraction of a full snapshot.
+inline void EncodeSnapshotDelta(const std::vector<uint8_t>& base, const std::vector<uint8_t>& current, std::vector<uint8_t>& delta) {
+    const auto size = static_cast<uint32_t>(current.size());
+    delta.resize(sizeof(size));
+    memcpy(delta.data(), &size, sizeof(size));
+
+    auto byteAt = [&](size_t i) -> uint8_t {
+        return current[i] ^ (i < base.size() ? base[i] : 0);
+    };
+
+    size_t i = 0;
+    while (i < current.size()) {
+        uint16_t unchanged = 0;
+        while (i < current.size() && unchanged < UINT16_MAX && byteAt(i) == 0) {
+            unchanged++;
+            i++;
+        }
+
+        const size_t changedStart = i;
+        uint16_t changed = 0;
+        while (i < current.size() && changed < UINT16_MAX && byteAt(i) != 0) {
+            changed++;
+            i++;
+        }
+
+        const size_t offset = delta.size();
+        delta.resize(offset + 2 * sizeof(uint16_t) + changed);
+        memcpy(delta.data() + offset, &unchanged, sizeof(unchanged));
+        memcpy(delta.data() + offset + sizeof(unchanged), &changed, sizeof(changed));
+        for (size_t j = 0; j < changed; j++) {
+            delta[offset + 2 * sizeof(uint16_t) + j] = byteAt(changedStart + j);
+        }
+    }
+}
+
+// Turns base into the snapshot the delta was encoded from
+inline bool ApplySnapshotDelta(std::vector<uint8_t>& base, const std::vector<uint8_t>& delta) {
+    uint32_t size = 0;
+    if (delta.size() < sizeof(size)) {
+        return false;
+    }
+    memcpy(&size, delta.data(), sizeof(size));
+
+    const size_t oldSize = base.size();
+    base.resize(size);
+    if (size > oldSize) {
+        memset(base.data() + oldSize, 0, size - oldSize);
+    }
+
+    size_t in = sizeof(size);
+    size_t out = 0;
+    while (in < delta.size()) {
+        uint16_t unchanged = 0;
+        uint16_t changed = 0;
+        if (delta.size() - in < 2 * sizeof(uint16_t)) {
+            return false;
+        }
+        memcpy(&unchanged, delta.data() + in, sizeof(unchanged));
+        memcpy(&changed, delta.data() + in + sizeof(unchanged), sizeof(changed));
+        in += 2 * sizeof(uint16_t);
+
+        out += unchanged;
+        if (out + changed > size || in + changed > delta.size()) {
+            return false;
+        }
+
+        for (size_t j = 0; j < changed; j++) {
+            base[out + j] ^= delta[in + j];
+        }
+        in += changed;
+        out += changed;
+    }
+
+    return true;
+}
+
+// Fixed number of recent snapshots for rewinding. Every KeyframeInterval-th entry is stored whole, the rest as
+// deltas against the entry before them. Slot buffers are reused, so once warmed up recording doesn't allocate.
+template<size_t Capacity, size_t KeyframeInterval = 30>
+class SnapshotRing {
+    static_assert(Capacity > KeyframeInterval, "Ring must hold at least one keyframe interval");
+
+private:
+    struct Slot {
+        std::vector<uint8_t> bytes;
+        bool keyframe = false;
+    };
+
+    Slot slots[Capacity];
+    std::vector<uint8_t> previous;
+    size_t count = 0;   // Valid entries, oldest first
+    size_t head = 0;    // Slot the next entry goes in
+    size_t sinceKeyframe = KeyframeInterval;
+    size_t reservedBytes = 0;
+
+public:
+    explicit SnapshotRing(size_t reserveBytesPerSlot = 0) {
+        for (Slot& slot : slots) {
+            slot.bytes.reserve(reserveBytesPerSlot);
+            reservedBytes += slot.bytes.capacity();
+        }
+        previous.reserve(reserveBytesPerSlot);
+        reservedBytes += previous.capacity();
+    }
+
+    void Clear() {
+        count = 0;
+        head = 0;
+        sinceKeyframe = KeyframeInterval;
+        previous.clear();
+    }
+
+    void Push(const std::vector<uint8_t>& snapshot) {
+        Slot& slot = slots[head];
+        const size_t capacityBefore = slot.bytes.capacity() + previous.capacity();
+
+        if (sinceKeyframe >= KeyframeInterval) {
+            slot.bytes.assign(snapshot.begin(), snapshot.end());
+            slot.keyframe = true;
+            sinceKeyframe = 0;
+        } else {
+            EncodeSnapshotDelta(previous, snapshot, slot.bytes);
+            slot.keyframe = false;
+        }
+
+        sinceKeyframe++;
+        previous.assign(snapshot.begin(), snapshot.end());
+        reservedBytes += slot.bytes.capacity() + previous.capacity() - capacityBefore;
+        head = (head + 1) % Capacity;
+        count = count < Capacity ? count + 1 : Capacity;
+
+        // Drop leading deltas whose keyframe was just overwritten
+        while (count > 0 && !slots[OldestSlot()].keyframe) {
+            count--;
+        }
+    }
+
+    // Entries available to Get, 0 = most recent
+    size_t Size() const {
+        return count;
+    }
+
+    // Grows only while a slot sees a bigger snapshot than it has held before
+    size_t ReservedBytes() const {
+        return reservedBytes;
+    }
+
+    bool Get(size_t age, std::vector<uint8_t>& out) const {
+        if (age >= count) {
+            return false;
+        }
+
+        size_t keyframeAge = age;
+        while (!slots[SlotForAge(keyframeAge)].keyframe) {
+            keyframeAge++;
+        }
+
+        out.assign(slots[SlotForAge(keyframeAge)].bytes.begin(), slots[SlotForAge(keyframeAge)].bytes.end());
+        for (size_t a = keyframeAge; a-- > age;) {
+            if (!ApplySnapshotDelta(out, slots[SlotForAge(a)].bytes)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Forgets everything newer than age, so recording continues from there after a rewind
+    void Truncate(size_t age) {
+        if (age >= count || age == 0) {
+            return;
+        }
+
+        Get(age, previous);
+        head = SlotForAge(age - 1);
+        count -= age;
+
+        sinceKeyframe = 0;
+        for (size_t a = 0; a < count && !slots[SlotForAge(a)].keyframe; a++) {
+            sinceKeyframe++;
+        }
+        sinceKeyframe++;
+    }
+
+private:
+    size_t SlotForAge(size_t age) const {
+        return (head + Capacity - 1 - age) % Capacity;
+    }
+
+    size_t OldestSlot() const {
+        return (head + Capacity - count) % Capacity;
+    }
+};
+
+inline bool SaveSnapshotToFile(const std::string& path, const std::vector<uint8_t>& snapshot) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(snapshot.data()), static_cast<std::streamsize>(snapshot.size()));
+    return static_cast<bool>(file);
+}
+
+inline bool LoadSnapshotFromFile(const std::string& path, std::vector<uint8_t>& snapshot) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+
+    snapshot.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(snapshot.data()), static_cast<std::streamsize>(snapshot.size()));
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+using SocketHandle = SOCKET;
+const SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+using SocketHandle = int;
+const SocketHandle INVALID_SOCKET_HANDLE = -1;
+#endif
+
+struct SocketAddress {
+    sockaddr_in address {};
+
+    static SocketAddress Loopback(uint16_t port) {
+        SocketAddress result;
+        result.address.sin_family = AF_INET;
+        result.address.sin_port = htons(port);
+        result.address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return result;
+    }
+
+    uint16_t Port() const {
+        return ntohs(address.sin_port);
+    }
+
+    bool operator==(const SocketAddress& other) const {
+        return address.sin_port == other.address.sin_port && address.sin_addr.s_addr == other.address.sin_addr.s_addr;
+    }
+};
+
+// Winsock has to be started before any socket is created and stopped after the last one is closed.
+// Does nothing on other platforms.
+class SocketLibrary {
+public:
+    SocketLibrary() {
+#ifdef _WIN32
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+    }
+
+    SocketLibrary(const SocketLibrary&) = delete;
+    SocketLibrary& operator=(const SocketLibrary&) = delete;
+
+    ~SocketLibrary() {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+};
+
+// IPv4 datagram socket. Sending from several threads at once is fine, receiving should stay on one thread.
+class UdpSocket {
+private:
+    SocketHandle handle = INVALID_SOCKET_HANDLE;
+
+public:
+    UdpSocket() = default;
+
+    UdpSocket(const UdpSocket&) = delete;
+    UdpSocket& operator=(const UdpSocket&) = delete;
+
+    ~UdpSocket() {
+        Close();
+    }
+
+    // Port 0 picks a free port, see LocalAddress
+    bool Bind(const SocketAddress& address, int receiveBufferBytes = 1 << 20) {
+        Close();
+        handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (handle == INVALID_SOCKET_HANDLE) {
+            return false;
+        }
+
+        // Many sessions bursting snapshots at once overflow the default buffer long before loopback is saturated
+        setsockopt(handle, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>(&receiveBufferBytes), sizeof(receiveBufferBytes));
+        setsockopt(handle, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>(&receiveBufferBytes), sizeof(receiveBufferBytes));
+
+        if (bind(handle, reinterpret_cast<const sockaddr*>(&address.address), sizeof(address.address)) != 0) {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void Close() {
+        if (handle != INVALID_SOCKET_HANDLE) {
+#ifdef _WIN32
+            closesocket(handle);
+#else
+            close(handle);
+#endif
+            handle = INVALID_SOCKET_HANDLE;
+        }
+    }
+
+    SocketAddress LocalAddress() const {
+        SocketAddress result;
+        socklen_t length = sizeof(result.address);
+        getsockname(handle, reinterpret_cast<sockaddr*>(&result.address), &length);
+        return result;
+    }
+
+    bool SendTo(const SocketAddress& to, const void* data, size_t size) {
+        // int on Windows, ssize_t elsewhere
+        const long long sent = sendto(handle, static_cast<const char*>(data), static_cast<int>(size), 0,
+                                      reinterpret_cast<const sockaddr*>(&to.address), sizeof(to.address));
+        return sent == static_cast<long long>(size);
+    }
+
+    // Waits up to timeoutMs (0 = just check) for a datagram. Returns its size, 0 if none arrived, -1 on error.
+    int ReceiveFrom(void* buffer, size_t capacity, SocketAddress& from, int timeoutMs) {
+#ifdef _WIN32
+        WSAPOLLFD pollFd {handle, POLLRDNORM, 0};
+        const int ready = WSAPoll(&pollFd, 1, timeoutMs);
+#else
+        pollfd pollFd {handle, POLLIN, 0};
+        const int ready = poll(&pollFd, 1, timeoutMs);
+#endif
+        if (ready <= 0) {
+            return ready;
+        }
+
+        socklen_t length = sizeof(from.address);
+        const auto received = recvfrom(handle, static_cast<char*>(buffer), static_cast<int>(capacity), 0,
+                                       reinterpret_cast<sockaddr*>(&from.address), &length);
+        return received < 0 ? -1 : static_cast<int>(received);
+    }
+};
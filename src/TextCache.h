@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstring>
+#include "SDL.h"
+#include "SDL_ttf.h"
+#include "RenderQueue.h"
+#include "Vec2Int.h"
+
+// Keeps rasterized text around between frames so static labels aren't re-rendered and re-uploaded every frame.
+// Entries are fixed-size and evicted least recently used, so lookups never allocate. A frame must not record more
+// than CAPACITY distinct texts, or an entry could be evicted before the queue that references it is submitted.
+class TextCache {
+public:
+    struct Text {
+        SDL_Texture* texture = nullptr;
+        int w = 0;
+        int h = 0;
+    };
+
+private:
+    static constexpr int CAPACITY = 64;
+    static constexpr int MAX_TEXT_LENGTH = 63;
+
+    struct Entry {
+        TTF_Font* font = nullptr;
+        char text[MAX_TEXT_LENGTH + 1] {};
+        Text value;
+        unsigned long long lastUsed = 0;
+    };
+
+    SDL_Renderer* renderer;
+    SDL_Color color;
+    Entry entries[CAPACITY];
+    unsigned long long useClock = 0;
+    unsigned long long misses = 0;
+
+public:
+    TextCache(SDL_Renderer* renderer, SDL_Color color) : renderer(renderer), color(color) {}
+
+    TextCache(const TextCache&) = delete;
+    TextCache& operator=(const TextCache&) = delete;
+
+    ~TextCache() {
+        Clear();
+    }
+
+    // Must run before the renderer is destroyed
+    void Clear() {
+        for (Entry& entry : entries) {
+            SDL_DestroyTexture(entry.value.texture);
+            entry = Entry();
+        }
+    }
+
+    unsigned long long Misses() const {
+        return misses;
+    }
+
+    void DrawToWidth(RenderQueue& queue, RenderLayer layer, const char* text, TTF_Font* font, Vec2Int pos, int width) {
+        const Text cached = Get(text, font);
+        const double ratio = static_cast<double>(cached.w) / static_cast<double>(cached.h);
+        const int height = static_cast<int>(static_cast<float>(width) / ratio);
+        queue.Text(layer, cached.texture, {pos.x, pos.y, width, height});
+    }
+
+    void DrawToHeight(RenderQueue& queue, RenderLayer layer, const char* text, TTF_Font* font, Vec2Int pos, int height) {
+        const Text cached = Get(text, font);
+        const double ratio = static_cast<double>(cached.h) / static_cast<double>(cached.w);
+        const int width = static_cast<int>(static_cast<float>(height) / ratio);
+        queue.Text(layer, cached.texture, {pos.x, pos.y, width, height});
+    }
+
+    Text Get(const char* text, TTF_Font* font) {
+        useClock++;
+
+        Entry* leastRecentlyUsed = &entries[0];
+        for (Entry& entry : entries) {
+            if (entry.font == font && strcmp(entry.text, text) == 0) {
+                entry.lastUsed = useClock;
+                return entry.value;
+            }
+
+            if (entry.lastUsed < leastRecentlyUsed->lastUsed) {
+                leastRecentlyUsed = &entry;
+            }
+        }
+
+        misses++;
+
+        Entry& entry = *leastRecentlyUsed;
+        SDL_DestroyTexture(entry.value.texture);
+        entry.value = Rasterize(text, font);
+        entry.lastUsed = useClock;
+
+        // Longer strings still render, they just won't be found again
+        entry.font = strlen(text) <= MAX_TEXT_LENGTH ? font : nullptr;
+        strncpy(entry.text, text, MAX_TEXT_LENGTH);
+        entry.text[MAX_TEXT_LENGTH] = '\0';
+
+        return entry.value;
+    }
+
+private:
+    Text Rasterize(const char* text, TTF_Font* font) {
+        Text result;
+        SDL_Surface* textSurface = TTF_RenderText_Blended(font, text, color);
+        if (textSurface == nullptr) {
+            return result;
+        }
+
+        result.texture = SDL_CreateTextureFromSurface(renderer, textSurface);
+        result.w = textSurface->w;
+        result.h = textSurface->h;
+        SDL_FreeSurface(textSurface);
+        return result;
+    }
+};
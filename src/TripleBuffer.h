@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single producer, single consumer hand-off of the latest value. The producer always has a slot of its
+// own to write into and the consumer always has a stable one to read from; the third is swapped between them.
+// Neither side ever waits, and a consumer that falls behind simply skips to the newest published value.
+template<typename T>
+class TripleBuffer {
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t FRESH = 0x4;
+
+    T slots[3];
+    uint8_t writeIndex = 0;
+    uint8_t readIndex = 1;
+    std::atomic<uint8_t> shared {2};
+
+public:
+    TripleBuffer() = default;
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Producer side. Fill in the returned slot completely, then Publish.
+    T& WriteSlot() {
+        return slots[writeIndex];
+    }
+
+    void Publish() {
+        writeIndex = shared.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // Consumer side. Returns false, keeping the current ReadSlot, if nothing new has been published.
+    bool Consume() {
+        if ((shared.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+
+        readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& ReadSlot() const {
+        return slots[readIndex];
+    }
+};
@@ -1,8 +1,13 @@
 #pragma once
 
-class Vec2 {
+#include "Scalar.h"
+
+template<typename T>
+class BasicVec2 {
 public:
-    double x, y;
+    T x, y;
+
+    constexpr BasicVec2(T x, T y) : x(x), y(y) {};
+};
 
-    Vec2(double x, double y) : x(x), y(y) {};
-};
\ No newline at end of file
+using Vec2 = BasicVec2<Scalar>;
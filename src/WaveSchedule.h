@@ -0,0 +1,568 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "json.hpp"
+#include "SDL.h"
+#include "EnemySpawner.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using string = std::string;
+using json = nlohmann::json;
+
+// Compiled wave file, written by --compile-waves. Native byte order like snapshots; every platform we ship is
+// little endian.
+//   header   WaveFileHeader
+//   records  WaveRecord[count], sorted by spawn time
+struct WaveFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t count;
+    uint64_t checksum;      // FNV-1a of the records
+};
+
+struct WaveRecord {
+    double spawnTime;       // ms
+    double startY;
+    double speedScale;
+    uint32_t type;          // EnemyType
+    uint32_t reserved;
+};
+
+static_assert(sizeof(WaveFileHeader) == 32 && sizeof(WaveRecord) == 32, "Wave file structs must have no padding");
+
+constexpr char WAVE_FILE_MAGIC[8] = {'L', 'D', '5', '4', 'W', 'A', 'V', 'E'};
+constexpr uint32_t WAVE_FILE_VERSION = 1;
+
+inline bool KnownEnemyType(uint32_t type) {
+    return type == VAN || type == PICKUP;
+}
+
+inline uint64_t WaveChecksum(const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// A whole file mapped read only. Pages are loaded by the OS as they're touched and can be dropped again under
+// memory pressure, since they're backed by the file.
+class MappedFile {
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+        Close();
+    }
+
+    bool Open(const string& path) {
+        Close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize {};
+        HANDLE mapping = nullptr;
+        if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+
+        // The view keeps the file open
+        if (mapping != nullptr) {
+            data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            size = data != nullptr ? static_cast<size_t>(fileSize.QuadPart) : 0;
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+#else
+        const int file = open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(file, &info) == 0 && info.st_size > 0) {
+            void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (view != MAP_FAILED) {
+                data = static_cast<const uint8_t*>(view);
+                size = static_cast<size_t>(info.st_size);
+            }
+        }
+        close(file);
+#endif
+
+        return data != nullptr;
+    }
+
+    void Close() {
+        if (data == nullptr) {
+            return;
+        }
+
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<uint8_t*>(data), size);
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    const uint8_t* Data() const {
+        return data;
+    }
+
+    size_t Size() const {
+        return size;
+    }
+};
+
+// Every spawn of a wave set in time order, read straight out of a mapped compiled wave file or held in memory.
+// Shared read only between every game playing it.
+class WaveSchedule {
+private:
+    MappedFile mapping;
+    std::vector<WaveRecord> owned;
+    const WaveRecord* records = nullptr;
+    size_t count = 0;
+
+public:
+    WaveSchedule() = default;
+
+    // Sorts if they aren't already
+    explicit WaveSchedule(std::vector<WaveRecord> spawns) : owned(std::move(spawns)) {
+        SortByTime(owned);
+        records = owned.data();
+        count = owned.size();
+    }
+
+    explicit WaveSchedule(const std::vector<EnemySpawn>& spawns) {
+        owned.reserve(spawns.size());
+        for (const EnemySpawn& spawn : spawns) {
+            owned.push_back({spawn.spawnTime, spawn.startY, spawn.speedScale, static_cast<uint32_t>(spawn.type), 0});
+        }
+
+        SortByTime(owned);
+        records = owned.data();
+        count = owned.size();
+    }
+
+    WaveSchedule(const WaveSchedule&) = delete;
+    WaveSchedule& operator=(const WaveSchedule&) = delete;
+
+    // Maps a compiled wave file after checking its header, size and checksum
+    bool Map(const string& path, string& error) {
+        if (!mapping.Open(path)) {
+            error = "can't open";
+            return false;
+        }
+
+        WaveFileHeader header {};
+        if (mapping.Size() < sizeof(header)) {
+            error = "truncated";
+            mapping.Close();
+            return false;
+        }
+        std::memcpy(&header, mapping.Data(), sizeof(header));
+
+        if (std::memcmp(header.magic, WAVE_FILE_MAGIC, sizeof(WAVE_FILE_MAGIC)) != 0) {
+            error = "not a wave file";
+        } else if (header.version != WAVE_FILE_VERSION || header.recordSize != sizeof(WaveRecord)) {
+            error = "wave file version " + std::to_string(header.version) + ", expected " + std::to_string(WAVE_FILE_VERSION);
+        } else if (header.count > (mapping.Size() - sizeof(header)) / sizeof(WaveRecord)) {
+            error = "truncated";
+        } else if (WaveChecksum(mapping.Data() + sizeof(header), header.count * sizeof(WaveRecord)) != header.checksum) {
+            error = "checksum mismatch";
+        } else if (!AllTypesKnown(reinterpret_cast<const WaveRecord*>(mapping.Data() + sizeof(header)), static_cast<size_t>(header.count))) {
+            error = "unknown enemy type";
+        } else {
+            // The header is 32 bytes into a page aligned mapping, so the records are aligned too
+            records = reinterpret_cast<const WaveRecord*>(mapping.Data() + sizeof(header));
+            count = static_cast<size_t>(header.count);
+            owned.clear();
+            return true;
+        }
+
+        mapping.Close();
+        return false;
+    }
+
+    bool Mapped() const {
+        return mapping.Data() != nullptr;
+    }
+
+    size_t Size() const {
+        return count;
+    }
+
+    EnemySpawn At(size_t index) const {
+        const WaveRecord& record = records[index];
+        return {record.spawnTime, static_cast<EnemyType>(record.type), record.startY, record.speedScale};
+    }
+
+    std::vector<EnemySpawn> ToSpawns() const {
+        std::vector<EnemySpawn> spawns;
+        spawns.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            spawns.push_back(At(i));
+        }
+        return spawns;
+    }
+
+    bool Save(const string& path) const {
+        WaveFileHeader header {};
+        std::memcpy(header.magic, WAVE_FILE_MAGIC, sizeof(WAVE_FILE_MAGIC));
+        header.version = WAVE_FILE_VERSION;
+        header.recordSize = sizeof(WaveRecord);
+        header.count = count;
+        header.checksum = WaveChecksum(records, count * sizeof(WaveRecord));
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records), static_cast<std::streamsize>(count * sizeof(WaveRecord)));
+        return static_cast<bool>(file);
+    }
+
+private:
+    static bool AllTypesKnown(const WaveRecord* records, size_t count) {
+        return std::all_of(records, records + count, [](const WaveRecord& record) {
+            return KnownEnemyType(record.type);
+        });
+    }
+
+    static void SortByTime(std::vector<WaveRecord>& spawns) {
+        const auto earlier = [](const WaveRecord& a, const WaveRecord& b) {
+            return a.spawnTime < b.spawnTime;
+        };
+
+        if (!std::is_sorted(spawns.begin(), spawns.end(), earlier)) {
+            std::sort(spawns.begin(), spawns.end(), earlier);
+        }
+    }
+};
+
+// Streams a wave JSON array, [{"spawn_time": seconds, "type": "VAN" | "PICKUP", "y": pixels}, ...], straight into
+// records without building a document. Other keys are skipped and spawns missing a field are dropped. An unknown
+// type stops the parse with an error.
+class WaveJsonReader : public nlohmann::json_sax<json> {
+private:
+    std::vector<WaveRecord>& records;
+    std::string lastError;
+
+    int depth = 0;
+    int field = FIELD_NONE;
+    WaveRecord current {};
+    bool hasTime = false;
+    bool hasType = false;
+    bool hasY = false;
+
+    enum {
+        FIELD_NONE,
+        FIELD_SPAWN_TIME,
+        FIELD_TYPE,
+        FIELD_Y
+    };
+
+public:
+    explicit WaveJsonReader(std::vector<WaveRecord>& records) : records(records) {}
+
+    const std::string& Error() const {
+        return lastError;
+    }
+
+    bool null() override {
+        return Value();
+    }
+
+    bool boolean(bool) override {
+        return Value();
+    }
+
+    bool number_integer(number_integer_t value) override {
+        return Number(static_cast<double>(value));
+    }
+
+    bool number_unsigned(number_unsigned_t value) override {
+        return Number(static_cast<double>(value));
+    }
+
+    bool number_float(number_float_t value, const string_t&) override {
+        return Number(value);
+    }
+
+    bool string(string_t& value) override {
+        if (depth == 2 && field == FIELD_TYPE) {
+            if (value == "VAN") {
+                current.type = VAN;
+                hasType = true;
+            } else if (value == "PICKUP") {
+                current.type = PICKUP;
+                hasType = true;
+            } else {
+                lastError = "unknown enemy type \"" + value + "\"";
+                return false;
+            }
+        }
+        return Value();
+    }
+
+    bool binary(binary_t&) override {
+        return Value();
+    }
+
+    bool start_object(std::size_t) override {
+        depth++;
+        if (depth == 2) {
+            current = {0.0, 0.0, 1.0, VAN, 0};
+            hasTime = false;
+            hasType = false;
+            hasY = false;
+        }
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool key(string_t& name) override {
+        if (depth != 2) {
+            field = FIELD_NONE;
+        } else if (name == "spawn_time") {
+            field = FIELD_SPAWN_TIME;
+        } else if (name == "type") {
+            field = FIELD_TYPE;
+        } else if (name == "y") {
+            field = FIELD_Y;
+        } else {
+            field = FIELD_NONE;
+        }
+        return true;
+    }
+
+    bool end_object() override {
+        if (depth == 2 && hasTime && hasType && hasY) {
+            records.push_back(current);
+        }
+        depth--;
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        depth++;
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool end_array() override {
+        depth--;
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& exception) override {
+        lastError = exception.what();
+        return false;
+    }
+
+private:
+    bool Value() {
+        field = FIELD_NONE;
+        return true;
+    }
+
+    bool Number(double value) {
+        if (depth == 2) {
+            switch (field) {
+                case FIELD_SPAWN_TIME:
+                    // Seconds in the file, milliseconds in the game
+                    current.spawnTime = value * 1000;
+                    hasTime = true;
+                    break;
+                case FIELD_Y:
+                    current.startY = value;
+                    hasY = true;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return Value();
+    }
+};
+
+inline bool ImportWaveJson(const string& path, std::vector<WaveRecord>& records, string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "can't open";
+        return false;
+    }
+
+    WaveJsonReader reader(records);
+    if (!json::sax_parse(file, &reader)) {
+        error = reader.Error();
+        return false;
+    }
+    return true;
+}
+
+inline string CompiledWavePath(const string& jsonPath) {
+    return std::filesystem::path(jsonPath).replace_extension(".waves").string();
+}
+
+// Maps the compiled form of a wave file if there is one no older than the JSON, otherwise streams the JSON.
+// Returns nullptr, with error saying why, if neither can be read.
+inline std::shared_ptr<const WaveSchedule> LoadWaveSchedule(const string& path, string& error) {
+    namespace fs = std::filesystem;
+    const string compiledPath = CompiledWavePath(path);
+
+    std::error_code ignored;
+    const bool haveCompiled = fs::exists(compiledPath, ignored);
+    const bool haveJson = compiledPath != path && fs::exists(path, ignored);
+    if (haveCompiled && (!haveJson || fs::last_write_time(compiledPath, ignored) >= fs::last_write_time(path, ignored))) {
+        auto schedule = std::make_shared<WaveSchedule>();
+        string mapError;
+        if (schedule->Map(compiledPath, mapError)) {
+            return schedule;
+        }
+        SDL_Log("Ignoring %s: %s", compiledPath.c_str(), mapError.c_str());
+    }
+
+    std::vector<WaveRecord> records;
+    string importError;
+    if (!ImportWaveJson(path, records, importError)) {
+        error = path + ": " + importError;
+        return nullptr;
+    }
+    return std::make_shared<WaveSchedule>(std::move(records));
+}
+
+// For callers that change the spawns per game
+inline bool LoadEnemySpawns(const string& path, std::vector<EnemySpawn>& spawns, string& error) {
+    const auto schedule = LoadWaveSchedule(path, error);
+    if (schedule == nullptr) {
+        return false;
+    }
+
+    spawns = schedule->ToSpawns();
+    return true;
+}
+
+// Plays back a fixed wave schedule such as game.json
+class ScriptedSpawner : public EnemySpawner {
+private:
+    std::shared_ptr<const WaveSchedule> schedule;
+    double timeScale;
+    size_t cursor = 0;
+    EnemySpawn current {};
+
+public:
+    explicit ScriptedSpawner(std::shared_ptr<const WaveSchedule> schedule, double timeScale = 1.0)
+            : schedule(std::move(schedule)), timeScale(timeScale) {}
+
+    explicit ScriptedSpawner(const std::vector<EnemySpawn>& spawns, double timeScale = 1.0)
+            : ScriptedSpawner(std::make_shared<const WaveSchedule>(spawns), timeScale) {}
+
+    const EnemySpawn* Peek() override {
+        if (cursor >= schedule->Size()) {
+            return nullptr;
+        }
+
+        current = schedule->At(cursor);
+        current.spawnTime *= timeScale;
+        return &current;
+    }
+
+    void Pop() override {
+        if (cursor < schedule->Size()) {
+            cursor++;
+        }
+    }
+
+    // Shares the schedule
+    std::unique_ptr<EnemySpawner> Clone() const override {
+        return std::make_unique<ScriptedSpawner>(*this);
+    }
+
+    void SaveState(SnapshotWriter& writer) const override {
+        writer.Write(static_cast<uint64_t>(cursor));
+    }
+
+    bool LoadState(SnapshotReader& reader) override {
+        uint64_t savedCursor = 0;
+        if (!reader.Read(savedCursor) || savedCursor > schedule->Size()) {
+            return false;
+        }
+
+        cursor = static_cast<size_t>(savedCursor);
+        return true;
+    }
+};
+
+inline void PrintCompileWavesUsage() {
+    std::cout << "Usage: LD54 --compile-waves IN.json [OUT.waves]\n"
+                 "Compiles a wave JSON file into the sorted binary schedule the game maps at startup. OUT defaults to\n"
+                 "IN with a .waves extension, which is where the game looks for it." << std::endl;
+}
+
+inline int RunCompileWavesCommand(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        PrintCompileWavesUsage();
+        return 1;
+    }
+
+    const string inPath = argv[2];
+    const string outPath = argc > 3 ? string(argv[3]) : CompiledWavePath(inPath);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<WaveRecord> records;
+    string error;
+    if (!ImportWaveJson(inPath, records, error)) {
+        std::cout << "Failed to read " << inPath << ": " << error << std::endl;
+        return 1;
+    }
+
+    const WaveSchedule schedule(std::move(records));
+    if (!schedule.Save(outPath)) {
+        std::cout << "Failed to write " << outPath << std::endl;
+        return 1;
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Compiled " << schedule.Size() << " spawns to " << outPath << " ("
+              << sizeof(WaveFileHeader) + schedule.Size() * sizeof(WaveRecord) << " bytes) in " << ms << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "SDL.h"
+#include "Game.h"
+#include "RenderQueue.h"
+#include "Simulation.h"
+
+struct GroundTextures {
+    SDL_Texture* floor = nullptr;
+    SDL_Texture* safeZone = nullptr;
+    SDL_Texture* wall = nullptr;
+    SDL_Texture* parkingLotEdge = nullptr;
+    SDL_Texture* parkingLot = nullptr;
+};
+
+// The playfield: ground, projectiles, placed entities and enemies. UI is recorded by the caller on top.
+inline void RecordWorld(RenderQueue& queue, const RenderSnapshot& view, const GroundTextures& groundTextures) {
+    for (int i = 0; i < GRID_WIDTH; i++) {
+        for (int j = 0; j < GRID_HEIGHT; j++) {
+            SDL_Texture* texture = nullptr;
+
+            switch (view.ground[i][j]) {
+                case DEFAULT_GROUND:
+                    texture = groundTextures.floor;
+                    break;
+                case SAFE_ZONE:
+                    texture = groundTextures.safeZone;
+                    break;
+                case WALL:
+                    texture = groundTextures.wall;
+                    break;
+                case PARKING_LOT:
+                    texture = i == GRID_WIDTH-1 ? groundTextures.parkingLotEdge : groundTextures.parkingLot;
+                    break;
+            }
+
+            queue.Sprite(LAYER_GROUND, texture, {i * BOX_SIZE.x, j * BOX_SIZE.y, BOX_SIZE.x, BOX_SIZE.y});
+        }
+    }
+
+    for (const Entity& projectile : view.projectiles) {
+        projectile.Draw(queue, LAYER_PROJECTILES);
+    }
+
+    for (const Entity& entity : view.placedEntities) {
+        entity.Draw(queue, LAYER_ENTITIES);
+    }
+
+    for (const Enemy& enemy : view.enemies) {
+        enemy.Draw(queue, LAYER_ENEMIES);
+    }
+}
@@ -1,181 +1,195 @@
 #define SDL_MAIN_HANDLED
 
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
 #include <iostream>
 #include <fstream>
+#include <new>
 #include <vector>
 #include "json.hpp"
 #include "SDL.h"
 #include "SDL_image.h"
 #include "SDL_mixer.h"
 #include "SDL_ttf.h"
+#include "AllocationCounter.h"
 #include "AudioHandler.h"
+#include "BalanceRunner.h"
 #include "BoxCollider.h"
 #include "Enemy.h"
+#include "FrameCapture.h"
 #include "Entity.h"
-#include "FrameTimer.h"
+#include "Game.h"
 #include "InputHandler.h"
+#include "LatencyHistogram.h"
+#include "Logger.h"
+#include "ParticleSystem.h"
+#include "PlacementPreview.h"
+#include "RenderBench.h"
+#include "RenderQueue.h"
+#include "ResourceCache.h"
+#include "ServerBench.h"
+#include "Simulation.h"
+#include "TextCache.h"
 #include "Vec2.h"
 #include "Vec2Int.h"
+#include "WaveSchedule.h"
+#include "WorldRenderer.h"
 
 using string = std::string;
 using json = nlohmann::json;
 
 const SDL_Color WHITE = {255, 255, 255, 255};
-const int TURRET_VALUE = 5;
-const int OBSTACLE_VALUE = 1;
 
-const char* GetAssetFolderPath() {
-    const char* platform = SDL_GetPlatform();
-
-    if (strcmp(platform, "Windows") == 0) {
-        return "assets/";
-    } else if (strcmp(platform, "Mac OS X") == 0) {
-        return "../Resources/";
-    } else {
-        return "";
+#ifndef NDEBUG
+// Debug builds count every heap allocation so the main loop can check that steady-state frames make none. Kept out
+// of line: inlined into a caller, GCC sees free() on memory from operator new and warns about the mismatch.
+[[gnu::noinline]] void* operator new(size_t size) {
+    AllocationCounter::ThreadCount()++;
+    if (void* pointer = malloc(size == 0 ? 1 : size)) {
+        return pointer;
     }
+    throw std::bad_alloc();
 }
 
-void DrawTextStringToWidth(const string& text, TTF_Font* font, Vec2Int pos, int width, SDL_Renderer* renderer) {
-    Vec2Int requestedSize {0, 0};
-    TTF_SizeUTF8(font, text.c_str(), &requestedSize.x, &requestedSize.y);
-    const double ratio = static_cast<double>(requestedSize.x) / static_cast<double>(requestedSize.y);
-    const int height = static_cast<int>(static_cast<float>(width) / ratio);
-    SDL_Surface* textSurface = TTF_RenderText_Blended(font, text.c_str(), WHITE);
-    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    SDL_FreeSurface(textSurface);
-    const SDL_Rect rect {pos.x, pos.y, width, height};
-    SDL_RenderCopy(renderer, textTexture, nullptr, &rect);
-    SDL_DestroyTexture(textTexture);
+[[gnu::noinline]] void operator delete(void* pointer) noexcept {
+    free(pointer);
 }
 
-void DrawTextStringToHeight(const string& text, TTF_Font* font, Vec2Int pos, int height, SDL_Renderer* renderer) {
-    Vec2Int requestedSize {0, 0};
-    TTF_SizeUTF8(font, text.c_str(), &requestedSize.x, &requestedSize.y);
-    const double ratio = static_cast<double>(requestedSize.y) / static_cast<double>(requestedSize.x);
-    const int width = static_cast<int>(static_cast<float>(height) / ratio);
-    SDL_Surface* textSurface = TTF_RenderText_Blended(font, text.c_str(), WHITE);
-    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    SDL_FreeSurface(textSurface);
-    const SDL_Rect rect {pos.x, pos.y, width, height};
-    SDL_RenderCopy(renderer, textTexture, nullptr, &rect);
-    SDL_DestroyTexture(textTexture);
+[[gnu::noinline]] void operator delete(void* pointer, size_t) noexcept {
+    free(pointer);
 }
 
-double Lerp(float start, float end, float t) {
-    return start + t * (end - start);
+// Over-aligned types, e.g. alignas(64) per-thread stats. The block malloc returned is stored just before the
+// aligned pointer so delete can free it.
+[[gnu::noinline]] void* operator new(size_t size, std::align_val_t alignment) {
+    AllocationCounter::ThreadCount()++;
+    const auto align = static_cast<uintptr_t>(alignment);
+    if (void* block = malloc(size + static_cast<size_t>(align) + sizeof(void*))) {
+        const uintptr_t aligned = (reinterpret_cast<uintptr_t>(block) + sizeof(void*) + align - 1) & ~(align - 1);
+        reinterpret_cast<void**>(aligned)[-1] = block;
+        return reinterpret_cast<void*>(aligned);
+    }
+    throw std::bad_alloc();
 }
 
-void SpawnEnemy(std::vector<Enemy>& enemies, const Vec2& pos, SDL_Texture* texture, const Vec2& size, double speed, int id) {
-    enemies.emplace_back(id, texture, BoxCollider({pos.x, pos.y}, {size.x, size.y}), speed);
+[[gnu::noinline]] void operator delete(void* pointer, std::align_val_t) noexcept {
+    if (pointer != nullptr) {
+        free(static_cast<void**>(pointer)[-1]);
+    }
 }
 
-void RemoveEnemy(std::vector<Enemy>& enemies, const Enemy& enemy) {
-    auto newEnd = std::remove_if(enemies.begin(), enemies.end(),
-                                 [&](const Enemy& iterEnemy) {
-                                     return enemy == iterEnemy;
-                                 });
-
-    enemies.erase(newEnd, enemies.end());
+[[gnu::noinline]] void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept {
+    operator delete(pointer, alignment);
 }
+#endif
 
-enum GroundType {
-    DEFAULT_GROUND,
-    SAFE_ZONE,
-    WALL,
-    PARKING_LOT
-};
+const char* GetAssetFolderPath() {
+    const char* platform = SDL_GetPlatform();
 
-enum EntityType {
-    NO_ENTITY,
-    TURRET,
-    OBSTACLE
-};
+    if (strcmp(platform, "Windows") == 0) {
+        return "assets/";
+    } else if (strcmp(platform, "Mac OS X") == 0) {
+        return "../Resources/";
+    } else {
+        return "";
+    }
+}
 
-enum EnemyType {
-    VAN,
-    PICKUP
-};
+// Batched per frame, so a burst of identical events plays its effect once. Compares running totals rather than
+// looking at events directly, since the render thread may skip simulation snapshots.
+void PlayGameEventEffects(const GameEventCounts& counts, GameEventCounts& played, AudioHandler& audioHandler) {
+    if (counts.enemiesSpawned != played.enemiesSpawned) {
+        audioHandler.PlayEffect("Alert");
+    }
 
-struct EnemySpawn {
-    double spawnTime;
-    EnemyType type;
-    double startY;
-};
+    if (counts.turretsFired != played.turretsFired) {
+        audioHandler.PlayEffect("TurretFire");
+    }
 
-struct Cell {
-    GroundType ground;
-    EntityType entityType;
-    Entity* entity = nullptr;
-};
+    if (counts.enemiesHit != played.enemiesHit) {
+        audioHandler.PlayEffect("HitEnemy");
+    }
 
-void RemoveEntity(Cell** map, std::pair<int, int> entity) {
-    Cell& cell = map[entity.first][entity.second];
-    if (cell.entityType != NO_ENTITY) {
-        delete cell.entity;
-        cell.entity = nullptr;
-        cell.entityType = NO_ENTITY;
+    if (counts.entitiesPlaced != played.entitiesPlaced) {
+        audioHandler.PlayEffect("PlaceEntity");
     }
-}
 
-bool SetNextSafeZoneCellToParkingLot(Cell** map, int gridWidth, int gridHeight) {
-    for (int i = 0; i < gridWidth; i++) {
-        for (int j = 0; j < gridHeight; j++) {
-            if (map[i][j].ground == SAFE_ZONE) {
-                map[i][j].ground = PARKING_LOT;
-                return true;
-            }
-        }
+    if (counts.entitiesSold != played.entitiesSold) {
+        audioHandler.PlayEffect("SellEntity");
     }
 
-    return false;
+    played = counts;
 }
 
-int main()
+// A placement posted to the simulation that isn't in a snapshot yet
+struct PendingPlacement {
+    int cellX = -1;
+    int cellY = -1;
+    EntityType type = NO_ENTITY;
+    Uint32 clickTime = 0;
+    bool predicted = false;     // Drawn ahead of the simulation this frame
+    bool measured = false;
+};
+
+double Lerp(float start, float end, float t) {
+    return start + t * (end - start);
+}
+
+int main(int argc, char* argv[])
 {
-    bool gameOver = false;
-    bool victorious = false;
-    int currentHighestEnemyId = 0;
-    double gameClock = 0.0f;
-    bool gameplayActive = false;
-    EntityType currentEntityType = NO_ENTITY;
-    int balance = 25;
-    const int GRID_WIDTH = 32;
-    const int GRID_HEIGHT = 18;
-    const Vec2Int boxSize {50, 50};
-    Cell** map = static_cast<Cell **>(malloc(sizeof(Cell) * GRID_WIDTH));
-    for (int i = 0; i < GRID_WIDTH; i++) {
-        map[i] = static_cast<Cell*>(malloc(sizeof(Cell) * GRID_HEIGHT));
+    if (argc > 1 && strcmp(argv[1], "--balance") == 0) {
+        return RunBalanceCommand(argc, argv, string(GetAssetFolderPath()) + "game.json");
     }
 
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < GRID_HEIGHT; j++) {
-            map[i][j].ground = WALL;
-            map[i][j].entityType = NO_ENTITY;
-            map[i][j].entity = nullptr;
-        }
+    if (argc > 1 && strcmp(argv[1], "--server") == 0) {
+        return RunServerCommand(argc, argv, string(GetAssetFolderPath()) + "game.json");
     }
 
-    for (int i = 4; i < GRID_WIDTH; i++) {
-        for (int j = 0; j < GRID_HEIGHT; j++) {
-            map[i][j].ground = DEFAULT_GROUND;
-            map[i][j].entityType = NO_ENTITY;
-            map[i][j].entity = nullptr;
-        }
+    if (argc > 1 && strcmp(argv[1], "--server-bench") == 0) {
+        return RunServerBenchCommand(argc, argv, string(GetAssetFolderPath()) + "game.json");
     }
 
-    for (int i = 0; i < GRID_HEIGHT; i++) {
-        map[GRID_WIDTH-3][i].ground = WALL;
+    if (argc > 1 && strcmp(argv[1], "--compile-waves") == 0) {
+        return RunCompileWavesCommand(argc, argv);
     }
 
-    BoxCollider wallCollider(boxSize.x * (GRID_WIDTH-3), 0, boxSize.x, boxSize.y * GRID_HEIGHT);
+    if (argc > 1 && strcmp(argv[1], "--render-bench") == 0) {
+        return RunRenderBenchCommand(argc, argv, GetAssetFolderPath());
+    }
+
+    bool endless = false;
+    bool lowLatencyInput = false;
+    unsigned int endlessSeed = static_cast<unsigned int>(time(nullptr));
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--low-latency") == 0) {
+            lowLatencyInput = true;
+        } else if (strcmp(argv[i], "--endless") == 0) {
+            endless = true;
+            if (i + 1 < argc && isdigit(argv[i + 1][0])) {
+                endlessSeed = static_cast<unsigned int>(strtoul(argv[++i], nullptr, 10));
+            }
+        }
+    }
 
-    for (int i = GRID_WIDTH-2; i < GRID_WIDTH; i++) {
-        for (int j = 0; j < GRID_HEIGHT; j++) {
-            map[i][j].ground = SAFE_ZONE;
+    // Before any window opens, so a broken wave file doesn't start a game that is already won
+    std::shared_ptr<const WaveSchedule> waves;
+    if (!endless) {
+        string error;
+        waves = LoadWaveSchedule(string(GetAssetFolderPath()) + "game.json", error);
+        if (waves == nullptr) {
+            const string message = "Could not load waves from " + error;
+            std::cout << message << std::endl;
+            SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "No Room", message.c_str(), nullptr);
+            return 1;
         }
     }
 
+    bool gameplayActive = false;
+    bool rewinding = false;
+    EntityType currentEntityType = NO_ENTITY;
+
     const int TARGET_WIDTH = 1600;
     const int TARGET_HEIGHT = 900;
     const double TARGET_ASPECT_RATIO = static_cast<double>(TARGET_WIDTH) / static_cast<double>(TARGET_HEIGHT);
@@ -204,167 +218,124 @@ int main()
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     SDL_Texture* renderTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, TARGET_WIDTH, TARGET_HEIGHT);
 
-    string wall1Path = GetAssetFolderPath();
-    wall1Path += "Wall1.png";
-    SDL_Texture* wall1Texture = IMG_LoadTexture(renderer, wall1Path.c_str());
-
-    string floor1Path = GetAssetFolderPath();
-    floor1Path += "Floor1.png";
-    SDL_Texture* floor1Texture = IMG_LoadTexture(renderer, floor1Path.c_str());
-
-    string floor2Path = GetAssetFolderPath();
-    floor2Path += "Floor2.png";
-    SDL_Texture* floor2Texture = IMG_LoadTexture(renderer, floor2Path.c_str());
-
-    string parkingLot1Path = GetAssetFolderPath();
-    parkingLot1Path += "ParkingLot1.png";
-    SDL_Texture* parkingLot1Texture = IMG_LoadTexture(renderer, parkingLot1Path.c_str());
-
-    string parkingLot2Path = GetAssetFolderPath();
-    parkingLot2Path += "ParkingLot2.png";
-    SDL_Texture* parkingLot2Texture = IMG_LoadTexture(renderer, parkingLot2Path.c_str());
-
-    string turretPath = GetAssetFolderPath();
-    turretPath += "Turret.png";
-    SDL_Texture* turretTexture = IMG_LoadTexture(renderer, turretPath.c_str());
-
-    string obstacle1Path = GetAssetFolderPath();
-    obstacle1Path += "Obstacle1.png";
-    SDL_Texture* obstacle1Texture = IMG_LoadTexture(renderer, obstacle1Path.c_str());
-
-    string projectilePath = GetAssetFolderPath();
-    projectilePath += "Projectile.png";
-    SDL_Texture* projectileTexture = IMG_LoadTexture(renderer, projectilePath.c_str());
-
-    string vanPath = GetAssetFolderPath();
-    vanPath += "Van.png";
-    SDL_Texture* vanTexture = IMG_LoadTexture(renderer, vanPath.c_str());
-
-    string pickupTruckPath = GetAssetFolderPath();
-    pickupTruckPath += "PickupTruck.png";
-    SDL_Texture* pickupTruckTexture = IMG_LoadTexture(renderer, pickupTruckPath.c_str());
-
-    string playButtonPath = GetAssetFolderPath();
-    playButtonPath += "PlayButton.png";
-    SDL_Texture* playButtonTexture = IMG_LoadTexture(renderer, playButtonPath.c_str());
-
-    string pauseButtonPath = GetAssetFolderPath();
-    pauseButtonPath += "PauseButton.png";
-    SDL_Texture* pauseButtonTexture = IMG_LoadTexture(renderer, pauseButtonPath.c_str());
-
-    string boldFontPath = GetAssetFolderPath();
-    boldFontPath += "Changa-Bold.ttf";
-    TTF_Font* boldFont = TTF_OpenFont(boldFontPath.c_str(), 120);
-
-    string mediumFontPath = GetAssetFolderPath();
-    mediumFontPath += "Changa-Medium.ttf";
-    TTF_Font* mediumFont = TTF_OpenFont(mediumFontPath.c_str(), 120);
-
-    string regularFontPath = GetAssetFolderPath();
-    regularFontPath += "Changa-Regular.ttf";
-    TTF_Font* regularFont = TTF_OpenFont(regularFontPath.c_str(), 120);
-
-    string semiBoldFontPath = GetAssetFolderPath();
-    semiBoldFontPath += "Changa-SemiBold.ttf";
-    TTF_Font* semiBoldFont = TTF_OpenFont(semiBoldFontPath.c_str(), 120);
+    // Everything below is loaded on first use, the world and entity textures straight away since the simulation
+    // keeps their pointers. Declared before any handle so it outlives them.
+    ResourceCache resources(renderer, GetAssetFolderPath());
+
+    TextureHandle wall1Texture = resources.Texture("Wall1.png");
+    TextureHandle floor1Texture = resources.Texture("Floor1.png");
+    TextureHandle floor2Texture = resources.Texture("Floor2.png");
+    TextureHandle parkingLot1Texture = resources.Texture("ParkingLot1.png");
+    TextureHandle parkingLot2Texture = resources.Texture("ParkingLot2.png");
+    TextureHandle turretTexture = resources.Texture("Turret.png");
+    TextureHandle obstacle1Texture = resources.Texture("Obstacle1.png");
+    TextureHandle projectileTexture = resources.Texture("Projectile.png");
+    TextureHandle vanTexture = resources.Texture("Van.png");
+    TextureHandle pickupTruckTexture = resources.Texture("PickupTruck.png");
+    TextureHandle playButtonTexture = resources.Texture("PlayButton.png");
+    TextureHandle pauseButtonTexture = resources.Texture("PauseButton.png");
+
+    FontHandle boldFont = resources.Font("Changa-Bold.ttf", 120);
+    FontHandle regularFont = resources.Font("Changa-Regular.ttf", 120);
+    FontHandle semiBoldFont = resources.Font("Changa-SemiBold.ttf", 120);
 
     std::vector<string> trackPaths = {
 
     };
 
-    string alertSoundPath = GetAssetFolderPath();
-    alertSoundPath += "Alert.wav";
-
-    string hitEnemySoundPath = GetAssetFolderPath();
-    hitEnemySoundPath += "HitEnemy.wav";
-
-    string turretFireSoundPath = GetAssetFolderPath();
-    turretFireSoundPath += "TurretFire.wav";
-
-    string placeEntitySoundPath = GetAssetFolderPath();
-    placeEntitySoundPath += "PlaceEntity.wav";
-
-    string sellEntitySoundPath = GetAssetFolderPath();
-    sellEntitySoundPath += "SellEntity.wav";
-
-    std::vector<string> effectPaths = {
-            alertSoundPath,
-            hitEnemySoundPath,
-            turretFireSoundPath,
-            placeEntitySoundPath,
-            sellEntitySoundPath
+    std::vector<string> effectFiles = {
+            "Alert.wav",
+            "HitEnemy.wav",
+            "TurretFire.wav",
+            "PlaceEntity.wav",
+            "SellEntity.wav"
     };
 
-    AudioHandler audioHandler(effectPaths, trackPaths);
-    FrameTimer frameTimer;
+    TextCache textCache(renderer, WHITE);
+    RenderQueue renderQueue;
+    ParticleSystem particles(renderer);
+    AudioHandler audioHandler(resources, effectFiles, trackPaths);
     InputHandler inputHandler;
+    Logger logger;
 
-    std::vector<Enemy> enemies;
-    std::vector<Entity> projectiles;
-
-    SDL_Rect turretButtonRect {25, 100, boxSize.x * 3, boxSize.y * 3};
+    SDL_Rect turretButtonRect {25, 100, BOX_SIZE.x * 3, BOX_SIZE.y * 3};
     BoxCollider turretButtonCollider(turretButtonRect);
     SDL_Rect turretButtonImgRect {turretButtonRect.x + 15, turretButtonRect.y + 15, turretButtonRect.w - 30, turretButtonRect.h - 30};
 
-    SDL_Rect obstacleButtonRect {25, turretButtonRect.y + turretButtonRect.h + 10, boxSize.x * 3, boxSize.y * 3};
+    SDL_Rect obstacleButtonRect {25, turretButtonRect.y + turretButtonRect.h + 10, BOX_SIZE.x * 3, BOX_SIZE.y * 3};
     BoxCollider obstacleButtonCollider(obstacleButtonRect);
     SDL_Rect obstacleButtonImgRect {obstacleButtonRect.x + 15, obstacleButtonRect.y + 15, obstacleButtonRect.w - 35, obstacleButtonRect.h - 30};
 
-    SDL_Rect sellButtonRect {25, obstacleButtonRect.y + obstacleButtonRect.h + 10, boxSize.x * 3, boxSize.y};
+    SDL_Rect sellButtonRect {25, obstacleButtonRect.y + obstacleButtonRect.h + 10, BOX_SIZE.x * 3, BOX_SIZE.y};
     BoxCollider sellButtonCollider(sellButtonRect);
 
-    SDL_Rect playButtonRect {25, sellButtonRect.y + sellButtonRect.h + 10, static_cast<int>(boxSize.x * 1.4), boxSize.y};
+    SDL_Rect playButtonRect {25, sellButtonRect.y + sellButtonRect.h + 10, static_cast<int>(BOX_SIZE.x * 1.4), BOX_SIZE.y};
     BoxCollider playButtonCollider(playButtonRect);
     SDL_Rect playButtonImgRect {playButtonRect.x + 15, playButtonRect.y + 5, playButtonRect.w - 30, playButtonRect.h - 10};
 
-    SDL_Rect pauseButtonRect {25 + playButtonRect.w + 10, sellButtonRect.y + sellButtonRect.h + 10, static_cast<int>(boxSize.x * 1.4), boxSize.y};
+    SDL_Rect pauseButtonRect {25 + playButtonRect.w + 10, sellButtonRect.y + sellButtonRect.h + 10, static_cast<int>(BOX_SIZE.x * 1.4), BOX_SIZE.y};
     BoxCollider pauseButtonCollider(pauseButtonRect);
     SDL_Rect pauseButtonImgRect {pauseButtonRect.x + 15, pauseButtonRect.y + 5, pauseButtonRect.w - 30, pauseButtonRect.h - 10};
 
-    string enemySpawnPath = GetAssetFolderPath();
-    enemySpawnPath += "game.json";
-    std::ifstream enemySpawnFile(enemySpawnPath);
-    json enemySpawnJson;
-    enemySpawnFile >> enemySpawnJson;
-    enemySpawnFile.close();
-
-    std::vector<EnemySpawn> enemySpawns;
-
-    for (const auto& item : enemySpawnJson) {
-        bool validEnemySpawn = true;
-
-        EnemySpawn enemySpawn{};
-        enemySpawn.spawnTime = item["spawn_time"];
-
-        // Convert from seconds to milliseconds
-        enemySpawn.spawnTime *= 1000;
-
-        string type = item["type"];
-
-        if (type == "VAN") {
-            enemySpawn.type = VAN;
-        } else if (type == "PICKUP") {
-            enemySpawn.type = PICKUP;
-        } else {
-            validEnemySpawn = false;
-        }
-
-        enemySpawn.startY = item["y"];
+    GroundTextures groundTextures;
+    groundTextures.floor = floor1Texture.Get();
+    groundTextures.safeZone = floor2Texture.Get();
+    groundTextures.wall = wall1Texture.Get();
+    groundTextures.parkingLotEdge = parkingLot1Texture.Get();
+    groundTextures.parkingLot = parkingLot2Texture.Get();
+
+    GameTextures gameTextures;
+    gameTextures.turret = turretTexture.Get();
+    gameTextures.obstacle = obstacle1Texture.Get();
+    gameTextures.projectile = projectileTexture.Get();
+    gameTextures.van = vanTexture.Get();
+    gameTextures.pickupTruck = pickupTruckTexture.Get();
+
+    std::unique_ptr<EnemySpawner> spawner;
+    if (endless) {
+        spawner = std::make_unique<EndlessSpawner>(endlessSeed);
+    } else {
+        spawner = std::make_unique<ScriptedSpawner>(waves);
+    }
 
-        if (validEnemySpawn) {
-            enemySpawns.push_back(enemySpawn);
-        }
+    string prefFolderPath;
+    string quickSavePath;
+    if (char* prefPath = SDL_GetPrefPath("peterrolfe", "No Room")) {
+        prefFolderPath = prefPath;
+        quickSavePath = prefFolderPath + "quicksave.bin";
+        SDL_free(prefPath);
     }
 
-    std::sort(enemySpawns.begin(), enemySpawns.end(), [](const EnemySpawn& a, const EnemySpawn& b) {
-       return a.spawnTime < b.spawnTime;
-    });
+    // The game runs on its own thread from here on, this thread only posts commands and draws snapshots
+    const GameConfig gameConfig;
+    std::unique_ptr<EnemySpawner> previewSpawner = spawner->Clone();
+    Simulation simulation(gameConfig, gameTextures, std::move(spawner), logger, quickSavePath);
+    PlacementPreview placementPreview(simulation, gameConfig, std::move(previewSpawner));
+    GameEventCounts playedEventCounts;
+    FrameCapture frameCapture(TARGET_WIDTH, TARGET_HEIGHT);
+
+    // Measured from the input event to just after the frame showing it is presented
+    LatencyHistogram cursorLatency("Mouse move to cursor shown");
+    LatencyHistogram placementLatency("Click to placement shown");
+    PendingPlacement pendingPlacement;
+    const Uint32 PLACEMENT_TIMEOUT_MS = 1000;
+
+    const int ALLOCATION_WARMUP_FRAMES = 10;
+    long long frameCount = 0;
+    Uint64 lastFrameTicks = SDL_GetTicks64();
+
+    // The achieved speed shown while falling behind, in half steps and changed at most twice a second, so the label
+    // is one of a handful of cached texts rather than a new one to rasterize whenever the estimate moves
+    const Uint64 SPEED_LABEL_INTERVAL_MS = 500;
+    double shownAchievedTimeScale = 0.0;
+    Uint64 speedLabelTicks = 0;
 
     while (!inputHandler.state.exit) {
-        if (enemySpawns.empty()) {
-            gameOver = true;
-            victorious = true;
-        }
+        const size_t allocationsAtFrameStart = AllocationCounter::ThreadCount();
+        const unsigned long long resourceLoadsAtFrameStart = resources.Loads();
+        const Uint64 frameTicks = SDL_GetTicks64();
+        const double frameDeltaMs = static_cast<double>(frameTicks - lastFrameTicks);
+        lastFrameTicks = frameTicks;
 
         inputHandler.Update();
         Vec2 mouseScalingRatio = {
@@ -372,367 +343,311 @@ int main()
                 static_cast<double>(TARGET_HEIGHT) / static_cast<double>(WINDOW_HEIGHT)
         };
 
-        Vec2Int adjustedMousePos = {
-                static_cast<int>(static_cast<double>(inputHandler.state.mousePos.x) * mouseScalingRatio.x),
-                static_cast<int>(static_cast<double>(inputHandler.state.mousePos.y) * mouseScalingRatio.y)
+        const auto toTargetPos = [&](const Vec2Int& windowPos) {
+            return Vec2Int {
+                    static_cast<int>(static_cast<double>(windowPos.x) * mouseScalingRatio.x),
+                    static_cast<int>(static_cast<double>(windowPos.y) * mouseScalingRatio.y)
+            };
         };
 
-        frameTimer.Update();
-
-        if (!gameOver) {
-            std::vector<Enemy> enemiesToRemove;
-            std::vector<std::pair<int, int>> entitiesToRemove; // By map coordinates
+        Vec2Int adjustedMousePos = toTargetPos(inputHandler.state.mousePos);
 
-            if (gameplayActive) {
-                gameClock += frameTimer.frameDeltaMs;
+        // Starting or stopping a capture opens a file and a thread
+        const bool frameMayAllocate = frameCount++ < ALLOCATION_WARMUP_FRAMES || inputHandler.state.f10KeyPressedThisFrame;
 
-                EnemySpawn& nextEnemySpawn = enemySpawns.front();
-                if (gameClock >= nextEnemySpawn.spawnTime && !enemySpawns.empty()) {
-                    if (nextEnemySpawn.type == VAN) {
-                        SpawnEnemy(enemies, {-25, nextEnemySpawn.startY}, vanTexture, {static_cast<double>(boxSize.x) * 1.5, static_cast<double>(boxSize.y) * 0.75}, 0.25, currentHighestEnemyId++);
-                    } else if (nextEnemySpawn.type == PICKUP) {
-                        SpawnEnemy(enemies, {-25, nextEnemySpawn.startY}, pickupTruckTexture, {static_cast<double>(boxSize.x) * 1.5, static_cast<double>(boxSize.y) * 0.75}, 0.25, currentHighestEnemyId++);
-                    }
-
-                    enemySpawns.erase(enemySpawns.begin());
-                    audioHandler.PlayEffect("Alert");
-                }
-
-                for (int i = 0; i < GRID_WIDTH; i++) {
-                    for (int j = 0; j < GRID_HEIGHT; j++) {
-                        if (map[i][j].entityType != NO_ENTITY) {
-                            map[i][j].entity->Update(frameTimer.frameDeltaMs);
-                            for (Enemy& enemy : enemies) {
-                                if (map[i][j].entity->collider.Intersects(enemy.collider) && !enemy.removed) {
-                                    enemiesToRemove.push_back(enemy);
-                                    enemy.removed = true;
-                                    entitiesToRemove.emplace_back(i, j);
-                                    audioHandler.PlayEffect("HitEnemy");
-                                }
-                            }
-                        }
-                    }
-                }
-
-                for (Enemy& enemy : enemies) {
-                    enemy.Update(frameTimer.frameDeltaMs);
-                    if (enemy.collider.Intersects(wallCollider)) {
-                        std::cout << "Enemy hit wall" << std::endl;
-
-                        // Lose four spaces
-                        if (!SetNextSafeZoneCellToParkingLot(map, GRID_WIDTH, GRID_HEIGHT)) {
-                            gameOver = true;
-                        }
-
-                        if (!SetNextSafeZoneCellToParkingLot(map, GRID_WIDTH, GRID_HEIGHT)) {
-                            gameOver = true;
-                        }
+        // Hold backspace to rewind, play resumes from wherever it's released
+        if (inputHandler.state.backspaceKeyPressed != rewinding) {
+            rewinding = inputHandler.state.backspaceKeyPressed;
+            simulation.Post({COMMAND_SET_REWINDING, 0, 0, NO_ENTITY, rewinding});
+        }
 
-                        if (!SetNextSafeZoneCellToParkingLot(map, GRID_WIDTH, GRID_HEIGHT)) {
-                            gameOver = true;
-                        }
+        if (inputHandler.state.f5KeyPressedThisFrame) {
+            simulation.Post({COMMAND_SAVE});
+        }
 
-                        if (!SetNextSafeZoneCellToParkingLot(map, GRID_WIDTH, GRID_HEIGHT)) {
-                            gameOver = true;
-                        }
+        if (inputHandler.state.f9KeyPressedThisFrame) {
+            simulation.Post({COMMAND_LOAD});
+        }
 
-                        enemiesToRemove.push_back(enemy);
-                    }
-                }
+        // F10 starts and stops recording the game to a video in the preferences folder
+        if (inputHandler.state.f10KeyPressedThisFrame) {
+            if (frameCapture.Active()) {
+                frameCapture.Stop();
+                frameCapture.PrintReport(std::cout);
+            } else {
+                frameCapture.Start(prefFolderPath + "capture-" + std::to_string(std::time(nullptr)) + ".y4m");
+            }
+        }
 
-                for (Entity& projectile : projectiles) {
-                    projectile.Update(frameTimer.frameDeltaMs);
-                    projectile.collider.pos.x -= frameTimer.frameDeltaMs;
+        // 1-5 pick 1x, 2x, 4x, 8x or 16x game speed
+        if (inputHandler.state.numberKeyPressedThisFrame >= 1 && inputHandler.state.numberKeyPressedThisFrame <= 5) {
+            simulation.Post({COMMAND_SET_TIME_SCALE, 0, 0, NO_ENTITY, false, 1 << (inputHandler.state.numberKeyPressedThisFrame - 1)});
+        }
 
-                    for (Enemy& enemy : enemies) {
-                        if (projectile.collider.Intersects(enemy.collider)) {
-                            std::cout << "Projectile hit enemy" << std::endl;
-                            enemiesToRemove.push_back(enemy);
-                            audioHandler.PlayEffect("HitEnemy");
-                        }
-                    }
-                }
-            }
+        const RenderSnapshot& view = simulation.LatestRenderSnapshot();
+        PlayGameEventEffects(view.eventCounts, playedEventCounts, audioHandler);
 
-            while (!enemiesToRemove.empty()) {
-                balance += 1;
-                RemoveEnemy(enemies, enemiesToRemove.front());
-                enemiesToRemove.erase(enemiesToRemove.begin());
-            }
+        EffectEvent effect;
+        while (simulation.PopEffect(effect)) {
+            particles.Emit(effect);
+        }
+        particles.Update(frameDeltaMs);
 
-            while (!entitiesToRemove.empty()) {
-                RemoveEntity(map, entitiesToRemove.front());
-                entitiesToRemove.erase(entitiesToRemove.begin());
-            }
+        renderQueue.Clear();
+        SDL_Color clearColor {0, 0, 0, 255};
 
-            int currentCellX = adjustedMousePos.x / boxSize.x;
-            int currentCellY = adjustedMousePos.y / boxSize.y;
-            Cell& currentCell = map[currentCellX][currentCellY];
+        if (!view.gameOver) {
+            int currentCellX = adjustedMousePos.x / BOX_SIZE.x;
+            int currentCellY = adjustedMousePos.y / BOX_SIZE.y;
+            const EntityType currentCellEntityType = view.entityTypes[currentCellX][currentCellY];
 
             if (playButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressedThisFrame) {
                 gameplayActive = true;
+                simulation.Post({COMMAND_SET_ACTIVE, 0, 0, NO_ENTITY, true});
             }
 
             if (pauseButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressedThisFrame) {
                 gameplayActive = false;
+                simulation.Post({COMMAND_SET_ACTIVE, 0, 0, NO_ENTITY, false});
             }
 
-            if (inputHandler.state.leftMousePressedThisFrame && currentCell.ground != WALL) {
-                if (currentCell.entityType != NO_ENTITY) {
-                    switch (currentEntityType) {
-                        case NO_ENTITY:
-                            audioHandler.PlayEffect("SellEntity");
-
-                            switch (currentCell.entityType) {
-                                case TURRET:
-                                    balance += TURRET_VALUE;
-                                    delete currentCell.entity;
-                                    currentCell.entity = nullptr;
-                                    currentCell.entityType = NO_ENTITY;
-                                    break;
-                                case OBSTACLE:
-                                    balance += OBSTACLE_VALUE;
-                                    delete currentCell.entity;
-                                    currentCell.entity = nullptr;
-                                    currentCell.entityType = NO_ENTITY;
-                                    break;
-                                default:
-                                    break;
-                            }
-                            break;
-                        default:
-                            break;
+            if (inputHandler.state.leftMousePressedThisFrame) {
+                if (currentCellEntityType != NO_ENTITY) {
+                    if (currentEntityType == NO_ENTITY) {
+                        simulation.Post({COMMAND_SELL_ENTITY, currentCellX, currentCellY});
                     }
                 } else {
-                    switch (currentEntityType) {
-                        case TURRET:
-                            if (balance >= TURRET_VALUE) {
-                                audioHandler.PlayEffect("PlaceEntity");
-                                currentCell.entity = new TurretEntity({static_cast<double>(currentCellX * boxSize.x), static_cast<double>(currentCellY * boxSize.y)},
-                                                                      {static_cast<double>(boxSize.x), static_cast<double>(boxSize.y)},
-                                                                      turretTexture,
-                                                                      {static_cast<double>(boxSize.x) / 2, static_cast<double>(boxSize.y) / 4},
-                                                                      projectileTexture,
-                                                                      projectiles,
-                                                                      audioHandler);
-                                currentCell.entityType = TURRET;
-                                balance -= TURRET_VALUE;
-                            }
-                            break;
-                        case OBSTACLE:
-                            if (balance >= OBSTACLE_VALUE) {
-                                audioHandler.PlayEffect("PlaceEntity");
-                                currentCell.entity = new Entity({static_cast<double>(currentCellX * boxSize.x), static_cast<double>(currentCellY * boxSize.y)}, {static_cast<double>(boxSize.x), static_cast<double>(boxSize.y)}, obstacle1Texture);
-                                currentCell.entityType = OBSTACLE;
-                                balance -= OBSTACLE_VALUE;
-                            }
-                            break;
-                        default:
-                            break;
-                    }
-                }
-            }
-
-            SDL_SetRenderTarget(renderer, renderTexture);
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
-
-            SDL_Rect currentlyHoveredCellRect {
-                    currentCellX * boxSize.x,
-                    currentCellY * boxSize.y,
-                    boxSize.x,
-                    boxSize.y
-            };
-
-
-            for (int i = 0; i < GRID_WIDTH; i++) {
-                for (int j = 0; j < GRID_HEIGHT; j++) {
-                    SDL_Rect rect {i * boxSize.x, j * boxSize.y, boxSize.x, boxSize.y};
-
-                    switch (map[i][j].ground) {
-                        case DEFAULT_GROUND:
-                            SDL_RenderCopy(renderer, floor1Texture, nullptr, &rect);
-                            break;
-                        case SAFE_ZONE:
-                            SDL_RenderCopy(renderer, floor2Texture, nullptr, &rect);
-                            break;
-                        case WALL:
-                            SDL_RenderCopy(renderer, wall1Texture, nullptr, &rect);
-                            break;
-                        case PARKING_LOT:
-                            if (i == GRID_WIDTH-1) {
-                                SDL_RenderCopy(renderer, parkingLot1Texture, nullptr, &rect);
-                            } else {
-                                SDL_RenderCopy(renderer, parkingLot2Texture, nullptr, &rect);
-                            }
-
-                            break;
-                    }
-                }
-            }
-
-            if (currentCell.entityType == NO_ENTITY) {
-                switch (currentEntityType) {
-                    case NO_ENTITY:
-                        break;
-                    case TURRET:
-                        SDL_RenderCopy(renderer, turretTexture, nullptr, &currentlyHoveredCellRect);
-                        break;
-                    case OBSTACLE:
-                        SDL_RenderCopy(renderer, obstacle1Texture, nullptr, &currentlyHoveredCellRect);
-                        break;
-                }
-            }
-
-            for (Entity& projectile : projectiles) {
-                projectile.Draw(renderer);
-            }
-
-            for (int i = 0; i < GRID_WIDTH; i++) {
-                for (int j = 0; j < GRID_HEIGHT; j++) {
-                    if (map[i][j].entityType != NO_ENTITY) {
-                        map[i][j].entity->Draw(renderer);
+                    simulation.Post({COMMAND_PLACE_ENTITY, currentCellX, currentCellY, currentEntityType});
+                    if (currentEntityType != NO_ENTITY) {
+                        pendingPlacement = {currentCellX, currentCellY, currentEntityType, inputHandler.state.leftMousePressedTime};
                     }
                 }
             }
 
-            for (Enemy& enemy : enemies) {
-                enemy.Draw(renderer);
-            }
+            RecordWorld(renderQueue, view, groundTextures);
+            particles.Record(renderQueue, LAYER_PARTICLES);
 
-            SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-            SDL_RenderDrawRect(renderer, &currentlyHoveredCellRect);
+            SDL_Rect menuRect {0, 0, BOX_SIZE.x * 4, GRID_HEIGHT * BOX_SIZE.y};
+            renderQueue.FillRect(LAYER_UI_BACKGROUND, {128, 128, 128, 255}, menuRect);
+            textCache.DrawToWidth(renderQueue, LAYER_UI_CONTENT, "No Room", boldFont.Get(), {25, 10}, (BOX_SIZE.x * 4) - 50);
 
-            SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
-            SDL_Rect menuRect {0, 0, boxSize.x * 4, GRID_HEIGHT * boxSize.y};
-            SDL_RenderFillRect(renderer, &menuRect);
-            DrawTextStringToWidth("No Room", boldFont, {25, 10}, (boxSize.x * 4) - 50, renderer);
+            char balanceStr[32];
+            snprintf(balanceStr, sizeof(balanceStr), "$: %d", view.balance);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, balanceStr, regularFont.Get(), {25, 50}, BOX_SIZE.y);
 
-            string balanceStr = "$: " + std::to_string(balance);
-            DrawTextStringToHeight(balanceStr, regularFont, {25, 50}, boxSize.y, renderer);
+            SDL_Color buttonColor;
 
             if (turretButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressed) {
-                SDL_SetRenderDrawColor(renderer, 144, 144, 144, 255);
+                buttonColor = {144, 144, 144, 255};
                 currentEntityType = TURRET;
             } else if (turretButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)})) {
-                SDL_SetRenderDrawColor(renderer, 192, 192, 192, 255);
+                buttonColor = {192, 192, 192, 255};
             } else {
-                SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+                buttonColor = {160, 160, 160, 255};
             }
 
-            SDL_RenderFillRect(renderer, &turretButtonRect);
-            SDL_RenderCopy(renderer, turretTexture, nullptr, &turretButtonImgRect);
-            DrawTextStringToHeight("Turret", regularFont, {turretButtonRect.x + 5, turretButtonRect.y}, 30, renderer);
-            DrawTextStringToWidth("$5", regularFont, {turretButtonRect.x + 5, turretButtonRect.y + turretButtonRect.h - 30}, 20, renderer);
+            renderQueue.FillRect(LAYER_UI_BUTTONS, buttonColor, turretButtonRect);
+            renderQueue.Sprite(LAYER_UI_CONTENT, turretTexture.Get(), turretButtonImgRect);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Turret", regularFont.Get(), {turretButtonRect.x + 5, turretButtonRect.y}, 30);
+            textCache.DrawToWidth(renderQueue, LAYER_UI_CONTENT, "$5", regularFont.Get(), {turretButtonRect.x + 5, turretButtonRect.y + turretButtonRect.h - 30}, 20);
 
             if (obstacleButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressed) {
-                SDL_SetRenderDrawColor(renderer, 144, 144, 144, 255);
+                buttonColor = {144, 144, 144, 255};
                 currentEntityType = OBSTACLE;
             } else if (obstacleButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)})) {
-                SDL_SetRenderDrawColor(renderer, 192, 192, 192, 255);
+                buttonColor = {192, 192, 192, 255};
             } else {
-                SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+                buttonColor = {160, 160, 160, 255};
             }
 
-            SDL_RenderFillRect(renderer, &obstacleButtonRect);
-            SDL_RenderCopy(renderer, obstacle1Texture, nullptr, &obstacleButtonImgRect);
-            DrawTextStringToHeight("Obstacle", regularFont, {obstacleButtonRect.x + 5, obstacleButtonRect.y}, 30, renderer);
-            DrawTextStringToWidth("$1", regularFont, {obstacleButtonRect.x + 5, obstacleButtonRect.y + obstacleButtonRect.h - 35}, 20, renderer);
+            renderQueue.FillRect(LAYER_UI_BUTTONS, buttonColor, obstacleButtonRect);
+            renderQueue.Sprite(LAYER_UI_CONTENT, obstacle1Texture.Get(), obstacleButtonImgRect);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Obstacle", regularFont.Get(), {obstacleButtonRect.x + 5, obstacleButtonRect.y}, 30);
+            textCache.DrawToWidth(renderQueue, LAYER_UI_CONTENT, "$1", regularFont.Get(), {obstacleButtonRect.x + 5, obstacleButtonRect.y + obstacleButtonRect.h - 35}, 20);
 
             if (sellButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressed) {
-                SDL_SetRenderDrawColor(renderer, 144, 144, 144, 255);
+                buttonColor = {144, 144, 144, 255};
                 currentEntityType = NO_ENTITY;
             } else if (sellButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)})) {
-                SDL_SetRenderDrawColor(renderer, 192, 192, 192, 255);
+                buttonColor = {192, 192, 192, 255};
             } else {
-                SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+                buttonColor = {160, 160, 160, 255};
             }
 
-            SDL_RenderFillRect(renderer, &sellButtonRect);
-            DrawTextStringToHeight("Sell", regularFont, {sellButtonRect.x + 15, sellButtonRect.y}, sellButtonRect.h, renderer);
+            renderQueue.FillRect(LAYER_UI_BUTTONS, buttonColor, sellButtonRect);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Sell", regularFont.Get(), {sellButtonRect.x + 15, sellButtonRect.y}, sellButtonRect.h);
 
             if (playButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressed) {
-                SDL_SetRenderDrawColor(renderer, 144, 255, 144, 255);
+                buttonColor = {144, 255, 144, 255};
             } else if (playButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)})) {
-                SDL_SetRenderDrawColor(renderer, 192, 255, 192, 255);
+                buttonColor = {192, 255, 192, 255};
             } else if (gameplayActive) {
-                SDL_SetRenderDrawColor(renderer, 160, 255, 160, 255);
+                buttonColor = {160, 255, 160, 255};
             } else {
-                SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+                buttonColor = {160, 160, 160, 255};
             }
 
-            SDL_RenderFillRect(renderer, &playButtonRect);
-            SDL_RenderCopy(renderer, playButtonTexture, nullptr, &playButtonImgRect);
+            renderQueue.FillRect(LAYER_UI_BUTTONS, buttonColor, playButtonRect);
+            renderQueue.Sprite(LAYER_UI_CONTENT, playButtonTexture.Get(), playButtonImgRect);
 
             if (pauseButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)}) && inputHandler.state.leftMousePressed) {
-                SDL_SetRenderDrawColor(renderer, 255, 144, 144, 255);
+                buttonColor = {255, 144, 144, 255};
             } else if (pauseButtonCollider.Contains({static_cast<double>(adjustedMousePos.x), static_cast<double>(adjustedMousePos.y)})) {
-                SDL_SetRenderDrawColor(renderer, 255, 192, 192, 255);
+                buttonColor = {255, 192, 192, 255};
             } else if (!gameplayActive) {
-                SDL_SetRenderDrawColor(renderer, 255, 160, 160, 255);
+                buttonColor = {255, 160, 160, 255};
             } else {
-                SDL_SetRenderDrawColor(renderer, 160, 160, 160, 255);
+                buttonColor = {160, 160, 160, 255};
             }
 
-            DrawTextStringToHeight("How to play", semiBoldFont, {playButtonRect.x , playButtonRect.y + 150}, 50, renderer);
-            DrawTextStringToHeight("Stop the cars", regularFont, {playButtonRect.x , playButtonRect.y + 200}, 37, renderer);
-            DrawTextStringToHeight("Kills = $", regularFont, {playButtonRect.x , playButtonRect.y + 225}, 37, renderer);
-            DrawTextStringToHeight("Save the grass", regularFont, {playButtonRect.x , playButtonRect.y + 250}, 37, renderer);
-
-            SDL_RenderFillRect(renderer, &pauseButtonRect);
-            SDL_RenderCopy(renderer, pauseButtonTexture, nullptr, &pauseButtonImgRect);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "How to play", semiBoldFont.Get(), {playButtonRect.x , playButtonRect.y + 150}, 50);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Stop the cars", regularFont.Get(), {playButtonRect.x , playButtonRect.y + 200}, 37);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Kills = $", regularFont.Get(), {playButtonRect.x , playButtonRect.y + 225}, 37);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Save the grass", regularFont.Get(), {playButtonRect.x , playButtonRect.y + 250}, 37);
 
-            SDL_SetRenderTarget(renderer, nullptr);
+            if (frameTicks - speedLabelTicks >= SPEED_LABEL_INTERVAL_MS) {
+                shownAchievedTimeScale = std::round(view.achievedTimeScale * 2.0) / 2.0;
+                speedLabelTicks = frameTicks;
+            }
 
-            if (aspectRatiosMatch) {
-                SDL_RenderCopy(renderer, renderTexture, nullptr, nullptr);
+            char speedStr[32];
+            if (view.fallingBehind) {
+                snprintf(speedStr, sizeof(speedStr), "Speed: %dx (%.1fx)", view.timeScale, shownAchievedTimeScale);
             } else {
-                // TODO: Letterbox / pillarbox
-                SDL_RenderCopy(renderer, renderTexture, nullptr, nullptr);
+                snprintf(speedStr, sizeof(speedStr), "Speed: %dx", view.timeScale);
+            }
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, speedStr, regularFont.Get(), {playButtonRect.x , playButtonRect.y + 300}, 37);
+
+            renderQueue.FillRect(LAYER_UI_BUTTONS, buttonColor, pauseButtonRect);
+            renderQueue.Sprite(LAYER_UI_CONTENT, pauseButtonTexture.Get(), pauseButtonImgRect);
+        } else if (!view.victorious) {
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "There's no more room", boldFont.Get(), {50, 50}, 150);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Thanks for playing! :)", regularFont.Get(), {50, 150}, 50);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "peterrolfe.com", regularFont.Get(), {50, 200}, 50);
+        } else {
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "You saved the grass! Yay!", boldFont.Get(), {50, 50}, 150);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "Thanks for playing! :)", regularFont.Get(), {50, 150}, 50);
+            textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, "peterrolfe.com", regularFont.Get(), {50, 200}, 50);
+            clearColor = {128, 128, 255, 255};
+        }
+
+        // The hover highlight goes in last. In low latency mode it follows the mouse as of now rather than as of the
+        // top of the frame, and a placement the simulation hasn't picked up yet is drawn as if it had.
+        if (!view.gameOver) {
+            if (lowLatencyInput) {
+                inputHandler.RefreshMousePosition();
+            }
+
+            const Vec2Int cursorPos = toTargetPos(inputHandler.state.mousePos);
+            const int hoveredCellX = std::clamp(cursorPos.x / BOX_SIZE.x, 0, GRID_WIDTH - 1);
+            const int hoveredCellY = std::clamp(cursorPos.y / BOX_SIZE.y, 0, GRID_HEIGHT - 1);
+            const SDL_Rect hoveredCellRect {hoveredCellX * BOX_SIZE.x, hoveredCellY * BOX_SIZE.y, BOX_SIZE.x, BOX_SIZE.y};
+
+            if (view.entityTypes[hoveredCellX][hoveredCellY] == NO_ENTITY) {
+                switch (currentEntityType) {
+                    case NO_ENTITY:
+                        break;
+                    case TURRET:
+                        renderQueue.Sprite(LAYER_PREVIEW, turretTexture.Get(), hoveredCellRect);
+                        break;
+                    case OBSTACLE:
+                        renderQueue.Sprite(LAYER_PREVIEW, obstacle1Texture.Get(), hoveredCellRect);
+                        break;
+                }
             }
 
-            SDL_RenderPresent(renderer);
-        } else if (gameOver && !victorious){
-            SDL_SetRenderTarget(renderer, renderTexture);
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderClear(renderer);
-            DrawTextStringToHeight("There's no more room", boldFont, {50, 50}, 150, renderer);
-            DrawTextStringToHeight("Thanks for playing! :)", regularFont, {50, 150}, 50, renderer);
-            DrawTextStringToHeight("peterrolfe.com", regularFont, {50, 200}, 50, renderer);
-            SDL_SetRenderTarget(renderer, nullptr);
+            renderQueue.OutlineRect(LAYER_OVERLAY, {255, 0, 0, 255}, hoveredCellRect);
+
+            // What the next few seconds would look like with the hovered placement, once the preview thread has caught up
+            const bool previewing = currentEntityType != NO_ENTITY && view.entityTypes[hoveredCellX][hoveredCellY] == NO_ENTITY;
+            placementPreview.Request(hoveredCellX, hoveredCellY, previewing ? currentEntityType : NO_ENTITY);
+            const PreviewResult& preview = placementPreview.Latest();
+            if (previewing && preview.placeable && preview.cellX == hoveredCellX && preview.cellY == hoveredCellY && preview.type == currentEntityType) {
+                for (const PreviewMarker& marker : preview.markers) {
+                    const SDL_Rect markerRect {static_cast<int>(marker.x) - 6, static_cast<int>(marker.y) - 6, 12, 12};
+                    if (marker.breach) {
+                        renderQueue.FillRect(LAYER_OVERLAY, {255, 64, 64, 255}, markerRect);
+                    } else {
+                        renderQueue.OutlineRect(LAYER_OVERLAY, {255, 255, 0, 255}, markerRect);
+                    }
+                }
+
+                char previewStr[48];
+                snprintf(previewStr, sizeof(previewStr), "%+d kills, %+d breaches", preview.kills - preview.baselineKills,
+                         preview.breaches - preview.baselineBreaches);
+                const Vec2Int previewPos {hoveredCellRect.x, std::max(0, hoveredCellRect.y - 30)};
+                textCache.DrawToHeight(renderQueue, LAYER_UI_CONTENT, previewStr, regularFont.Get(), previewPos, 30);
+            }
+
+            pendingPlacement.predicted = false;
+            if (lowLatencyInput && pendingPlacement.type != NO_ENTITY && SDL_GetTicks() - pendingPlacement.clickTime < PLACEMENT_TIMEOUT_MS) {
+                const int cellX = pendingPlacement.cellX;
+                const int cellY = pendingPlacement.cellY;
+                const int cost = pendingPlacement.type == TURRET ? gameConfig.turretValue : gameConfig.obstacleValue;
+                if (view.entityTypes[cellX][cellY] == NO_ENTITY && view.ground[cellX][cellY] != WALL && view.balance >= cost) {
+                    const SDL_Rect cellRect {cellX * BOX_SIZE.x, cellY * BOX_SIZE.y, BOX_SIZE.x, BOX_SIZE.y};
+                    renderQueue.Sprite(LAYER_ENTITIES, pendingPlacement.type == TURRET ? turretTexture.Get() : obstacle1Texture.Get(), cellRect);
+                    pendingPlacement.predicted = true;
+                }
+            }
+        }
+
+        SDL_SetRenderTarget(renderer, renderTexture);
+        SDL_SetRenderDrawColor(renderer, clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+        SDL_RenderClear(renderer);
+        renderQueue.Submit(renderer);
+        frameCapture.Capture(renderer);
+        SDL_SetRenderTarget(renderer, nullptr);
+
+        if (aspectRatiosMatch) {
             SDL_RenderCopy(renderer, renderTexture, nullptr, nullptr);
-            SDL_RenderPresent(renderer);
         } else {
-            SDL_SetRenderTarget(renderer, renderTexture);
-            SDL_SetRenderDrawColor(renderer, 128, 128, 255, 255);
-            SDL_RenderClear(renderer);
-            DrawTextStringToHeight("You saved the grass! Yay!", boldFont, {50, 50}, 150, renderer);
-            DrawTextStringToHeight("Thanks for playing! :)", regularFont, {50, 150}, 50, renderer);
-            DrawTextStringToHeight("peterrolfe.com", regularFont, {50, 200}, 50, renderer);
-            SDL_SetRenderTarget(renderer, nullptr);
+            // TODO: Letterbox / pillarbox
             SDL_RenderCopy(renderer, renderTexture, nullptr, nullptr);
-            SDL_RenderPresent(renderer);
         }
+
+        SDL_RenderPresent(renderer);
+
+        const Uint32 presentTime = SDL_GetTicks();
+        if (inputHandler.state.mouseMovedThisFrame) {
+            cursorLatency.Add(presentTime - inputHandler.state.mouseMovedTime);
+        }
+
+        if (pendingPlacement.type != NO_ENTITY) {
+            const bool placed = view.entityTypes[pendingPlacement.cellX][pendingPlacement.cellY] == pendingPlacement.type;
+            if ((placed || pendingPlacement.predicted) && !pendingPlacement.measured) {
+                placementLatency.Add(presentTime - pendingPlacement.clickTime);
+                pendingPlacement.measured = true;
+            }
+
+            if (placed) {
+                pendingPlacement = PendingPlacement();
+            } else if (presentTime - pendingPlacement.clickTime >= PLACEMENT_TIMEOUT_MS) {
+                // Turned down by the simulation
+                pendingPlacement = PendingPlacement();
+            }
+        }
+
+        // Compiled out along with the counting operator new in release builds. Lazily loading an asset may allocate.
+        SDL_assert(frameMayAllocate || resources.Loads() != resourceLoadsAtFrameStart || AllocationCounter::ThreadCount() == allocationsAtFrameStart);
     }
 
-    free(map);
+    if (frameCapture.Active()) {
+        frameCapture.Stop();
+        frameCapture.PrintReport(std::cout);
+    }
+
+    std::cout << "Input latency" << (lowLatencyInput ? " (low latency mode)" : "") << std::endl;
+    cursorLatency.PrintReport(std::cout);
+    placementLatency.PrintReport(std::cout);
+    placementPreview.Stop();
+    placementPreview.PrintReport(std::cout);
+
+    textCache.Clear();
+    particles.Clear();
     SDL_DestroyTexture(renderTexture);
-    SDL_DestroyTexture(wall1Texture);
-    SDL_DestroyTexture(floor1Texture);
-    SDL_DestroyTexture(floor2Texture);
-    SDL_DestroyTexture(parkingLot1Texture);
-    SDL_DestroyTexture(parkingLot2Texture);
-    SDL_DestroyTexture(turretTexture);
-    SDL_DestroyTexture(obstacle1Texture);
-    SDL_DestroyTexture(projectileTexture);
-    SDL_DestroyTexture(vanTexture);
-    SDL_DestroyTexture(pickupTruckTexture);
-    SDL_DestroyTexture(playButtonTexture);
-    SDL_DestroyTexture(pauseButtonTexture);
-    TTF_CloseFont(boldFont);
-    TTF_CloseFont(mediumFont);
-    TTF_CloseFont(regularFont);
-    TTF_CloseFont(semiBoldFont);
+    resources.PrintReport(std::cout);
+    resources.Clear();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();